@@ -13,6 +13,10 @@
 #define BITVECTOR_FORMAT_BIN 1
 
 
+// Bitmap storage is padded with zeros to a whole number of 512 bit lanes
+#define BITVECTOR_LANE_WORDS 8
+
+
 // Bit vector class
 class bitVector {
   private:
@@ -31,13 +35,15 @@ class bitVector {
     // General utility
     void reset(void);
     void init(uint32_t l);
+    void assign(uint32_t l, const uint64_t *data);
     std::string str(uint8_t format);
 
     // Low level access
     uint64_t getBitmap(uint32_t bitmapIndex);
     void setBitmap(uint32_t bitmapIndex, uint64_t bitmapValue);
     uint32_t getLength(void) {return this->length;}
-    uint32_t getBitmapCount(void) {return this->bitmaps.size();}
+    uint32_t getBitmapCount(void) {return (this->length + 63) / 64;}
+    const uint64_t *getBitmapData(void) {return this->bitmaps.data();}
     uint64_t bitmapMask(uint32_t bitmapIndex);
 
     // Normal access
@@ -10,6 +10,20 @@
 #define DEFAULT_SUBPOP_SIZE "4"
 #define DEFAULT_GENOME_SIZE "1024"
 #define DEFAULT_THREAD_COUNT "2"
+#define DEFAULT_EVALUATOR "sweep"
+#define DEFAULT_LANE_WIDTH "auto"
+#define DEFAULT_EARLY_EXIT "false"
+#define DEFAULT_LAMBDA "0"
+#define DEFAULT_SAMPLE_BITMAPS "0"
+#define DEFAULT_FITNESS_CACHE "4096"
+#define DEFAULT_ASYNC_MIGRATION "false"
+#define DEFAULT_MAX_STALENESS "4"
+#define DEFAULT_STOP_ZERO_ERRORS "false"
+#define DEFAULT_STOP_CHIPS "0"
+#define DEFAULT_STOP_TIME "0"
+#define DEFAULT_STOP_STAGNATION "0"
+#define DEFAULT_TABLE_BUDGET "0"
+#define DEFAULT_GENERATED_TARGET "none"
 
 
 #endif // CONFIG_HPP
@@ -6,6 +6,7 @@
 #include "stdint.h"
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include <string>
 #include <sstream>
 #include <random>
@@ -14,10 +15,18 @@
 
 // Internal
 #include "mpi.h"
+#include <omp.h>
 #include "truthTable.hpp"
+#include "rng.hpp"
+
+
+// Crossover migrations are tagged below this, asynchronous elite migrations from it up
+#define ELITE_MIGRATION_TAG_BASE 0x4000
 
 
 // Class pre-declarations
+class genome;
+class fitnessCache;
 class populationAlgorithm;
 class subPopulationAlgorithm;
 
@@ -56,6 +65,14 @@ inline std::string str(geneFunction_t const fn) {
 }
 
 
+// Genome evaluation engine selection
+typedef enum : uint8_t {
+  GENOME_EVAL_RECURSIVE,    // Recursive evaluation through gene::getOutputBuffer
+  GENOME_EVAL_SWEEP,        // Flat forward sweep over a compiled active gene list
+  GENOME_EVAL_INCREMENTAL   // Persistent gene buffers, re-evaluates only mutated cones
+} genomeEvaluator_t;
+
+
 // Minimal gene datastructure for transmission over the network
 typedef struct {
   geneFunction_t function;
@@ -64,49 +81,76 @@ typedef struct {
 } geneNetworkFrame_t;
 
 
+// A mutation held aside from its genome, the gene at index takes on frame
+typedef struct {
+  uint32_t index;
+  geneNetworkFrame_t frame;
+} geneMutation_t;
 
-// Gene class, represents a gene within a genome
+
+
+// Gene class, a view of a single gene within a genome's gene arrays
 class gene {
-  public:
+  private:
 
-    bool bufValid;              // Flag to indicate whether or not output value buffer is valid
-    geneFunction_t function;    // Character representative of gene logic function
-    uint16_t aIndex;            // Input index A
-    uint16_t bIndex;            // Input index B
-    uint64_t buf;               // Output buffer bitmap
+    genome *owner;              // Genome holding the gene arrays
+    uint32_t index;             // Position of the gene within the genome
 
   public:
 
-    // Constructors
-    gene(void);                 // Blank
-    gene(geneNetworkFrame_t);   // From network frame
-    uint64_t getOutputBuffer(std::vector<gene>& genes);   // Get gene output buffer recursively
+    // Constructor
+    gene(genome *owner, uint32_t index);
     uint64_t computeBufferValue(uint64_t a, uint64_t b);  // Calculate gene output with given inputs
 
     // Gets and sets for gene functions
-    char getGeneFunction(void) {return this->function;}
-    void setGeneFunction(geneFunction_t const fn) {this->function = fn;}
-    bool isActive(void) {return this->bufValid;}
+    geneFunction_t getGeneFunction(void);
+    void setGeneFunction(geneFunction_t const fn) {this->setFunction(fn);}
+    bool isActive(void);
 
-    // Gets and sets for output buffer
-    void clearBuffer(void) {this->bufValid = false;}
-    void overrideBuffer(uint64_t iv);
+    // Gets for input indices
+    uint16_t getAIndex(void);
+    uint16_t getBIndex(void);
 
     // General operations
-    void setFunction(geneFunction_t const fn) {this->function = fn;}
-    void setAIndex(uint16_t const a) {this->aIndex = a;}
-    void setBIndex(uint16_t const b) {this->bIndex = b;}
-    bool mutate(uint32_t minIndex, uint32_t maxIndex, std::vector<char> fnPool);
-    bool mutate(uint32_t selectedIndex, subPopulationAlgorithm& algorithm);
+    void setFunction(geneFunction_t const fn);
+    void setAIndex(uint16_t const a);
+    void setBIndex(uint16_t const b);
+    bool mutate(subPopulationAlgorithm& algorithm);
 
-    // Generates and returns a gene template
+    // Randomly mutates one characteristic of a frame for the gene at index
+    static void mutateFrame(geneNetworkFrame_t& frame, uint32_t index, subPopulationAlgorithm& algorithm);
+
+    // Generates and returns a gene template, or sets the gene from one
     geneNetworkFrame_t getNetworkFrame(void);
+    void setNetworkFrame(geneNetworkFrame_t const& frame);
 };
 
 
 
 //========[GENOME]===============================================================================//
 
+// Compiled gene instruction, one per active gene, consumed by the sweep evaluator
+// Indices refer to scratch slots, inputs first then active genes in evaluation order
+typedef struct {
+  uint16_t aIndex;              // Input slot A
+  uint16_t bIndex;              // Input slot B (equal to A for unary functions)
+  uint16_t outIndex;            // Output slot
+  geneFunction_t function;      // Gene logic function
+} geneInstruction_t;
+
+
+// Per thread evaluation scratch space, shared by every genome evaluated on a thread
+typedef struct {
+  std::vector<geneInstruction_t> program;   // Compiled active gene list
+  std::vector<uint16_t> outputSlots;        // Scratch slot of each output gene
+  std::vector<uint16_t> slots;              // Gene to scratch slot mapping
+  std::vector<uint8_t> flags;               // Per gene flags (activity, buffer validity)
+  std::vector<uint64_t> buffers;            // Gene output buffers
+  std::vector<geneMutation_t> undo;         // Genes displaced while evaluating offspring
+  uint32_t slotCount;                       // Slots used by the compiled program
+} evaluationScratch_t;
+
+
 // Struct to contain genome performance data
 typedef struct {
 
@@ -171,22 +215,82 @@ typedef struct {
 } genomePerf_t;
 
 
+// Sample of the table offspring are screened on before a full sweep, every lane of the
+// table is sampled in turn as the sample rotates. Offspring bit errors over the whole table
+// are estimated as the parent's plus the change on the sample, scaled up to the table
+typedef struct {
+  std::vector<uint32_t> bitmaps;    // First bitmap of each sampled lane, ascending
+  double scale;                     // Table lanes per sampled lane
+  uint32_t parentBitErrors;         // Parent bit errors over the whole table
+  uint32_t parentSampleErrors;      // Parent bit errors over the sample
+} sampleScreen_t;
+
+
 
 // Genome class, represents an individual
 class genome {
   private:
 
-    // Genome state information
-    std::vector<gene> genes;                 // Gene array
+    // Gene arrays, one entry per gene (structure of arrays)
+    std::vector<geneFunction_t> functions;   // Gene logic functions
+    std::vector<uint16_t> aIndices;          // Input indices A
+    std::vector<uint16_t> bIndices;          // Input indices B
+    std::vector<uint8_t> activeFlags;        // Set for inputs and genes which drive an output
 
     // Genome performance data relative to input pattern used during evaluation
     genomePerf_t perfData;
     bool perfDataValid;
 
+    // Evaluation engine
+    genomeEvaluator_t evaluator;
+
+    // Incremental evaluator state, gene output buffers for every bitmap (gene major),
+    // per output bit error counts and genes mutated since the buffers were last updated
+    std::vector<uint64_t> geneBuffers;
+    std::vector<uint32_t> outputErrors;
+    std::vector<uint16_t> dirtyGenes;
+    uint32_t geneBufferStride;
+    bool geneBuffersValid;
+
   private:
 
     // Update performance data
     void updatePerfData(truthTable& target);
+    void updatePerfDataRecursive(truthTable& target);
+    bool updatePerfDataSweep(truthTable& target, uint32_t(*ff)(genomePerf_t) = NULL, uint32_t fitnessBudget = 0);
+    void updatePerfDataIncremental(truthTable& target);
+
+    // Incremental evaluator helpers
+    bool evaluateGeneBuffer(uint32_t geneIndex);
+    uint32_t outputBitErrors(truthTable& target, uint32_t outputIndex);
+    void rebuildGeneBuffers(truthTable& target);
+    uint32_t updateGeneCones(truthTable& target, std::vector<uint16_t> const& genes, bool keep);
+    void invalidateGeneBuffers(void) {this->geneBuffersValid = false; this->dirtyGenes.clear();}
+    bool hasCurrentGeneBuffers(truthTable& target) const {
+      return this->evaluator == GENOME_EVAL_INCREMENTAL && this->geneBuffersValid &&
+             this->dirtyGenes.empty() && this->geneBufferStride == target.getBitmapCount();
+    }
+
+    // Build the compiled active gene list in topological order
+    void compileProgram(truthTable& target, evaluationScratch_t& scratch);
+
+    // Sweep a compiled program, stopping early once fitness under ff exceeds the budget
+    bool sweepProgram(truthTable& target, evaluationScratch_t& scratch, genomePerf_t& perf,
+                      uint32_t(*ff)(genomePerf_t), uint32_t fitnessBudget);
+
+    // Overwrite genes with the given mutations
+    void applyMutations(std::vector<geneMutation_t> const& mutations);
+
+    // Recursive evaluation of a single gene
+    uint64_t recursiveOutputBuffer(uint32_t geneIndex, evaluationScratch_t& scratch);
+
+    // Unary functions only take input A
+    bool isUnary(uint32_t geneIndex) {
+      return (this->functions[geneIndex] == GENE_FN_NOP) || (this->functions[geneIndex] == GENE_FN_NOT);
+    }
+
+    // Genes are views of the gene arrays
+    friend class gene;
 
   public:
 
@@ -194,19 +298,68 @@ class genome {
     genome(uint32_t geneCount, subPopulationAlgorithm& algorithm);
 
     // Gets for genome data
-    uint32_t getGeneCount(void) {return this->genes.size();}
-    std::vector<gene> getGenes(void) {return this->genes;}
+    uint32_t getGeneCount(void) const {return this->functions.size();}
+    gene getGene(uint32_t i) {return gene(this, i);}
+    std::vector<geneFunction_t> const& getFunctions(void) const {return this->functions;}
+    std::vector<uint16_t> const& getAIndices(void) const {return this->aIndices;}
+    std::vector<uint16_t> const& getBIndices(void) const {return this->bIndices;}
     genomePerf_t getPerfData(truthTable& target);
+    bool isEvaluated(void) const {return this->perfDataValid;}
+    std::vector<uint8_t> const& getActiveFlags(void) const {return this->activeFlags;}
+
+    // Evaluate, giving up once fitness under ff is certain to exceed the budget
+    // Returns false if the genome was rejected
+    bool evaluateWithinBudget(truthTable& target, uint32_t(*ff)(genomePerf_t), uint32_t fitnessBudget);
+
+    // Evaluate a batch of genomes a table block at a time, those over budget are left unevaluated
+    // Given a sample screen of their common parent, genomes whose fitness estimated from the
+    // sample exceeds the budget are rejected before the full sweep
+    // Given a fitness cache, genomes whose compiled program is cached skip evaluation, and
+    // genomes evaluated in full are added to it
+    static void evaluateBatch(truthTable& target, std::vector<genome *> const& genomes,
+                              uint32_t(*ff)(genomePerf_t) = NULL, uint32_t fitnessBudget = 0,
+                              sampleScreen_t const *screen = NULL, fitnessCache *cache = NULL);
+
+    // Bit errors over the sampled lanes alone
+    uint32_t sampleBitErrors(truthTable& target, std::vector<uint32_t> const& sample);
+
+    // Get and set for evaluation engine
+    genomeEvaluator_t getEvaluator(void) {return this->evaluator;}
+    void setEvaluator(genomeEvaluator_t const e) {
+      this->evaluator = e;
+      this->perfDataValid = false;
+      this->invalidateGeneBuffers();
+    }
 
     // Operators
     void mutate(subPopulationAlgorithm& behaviour);
     void incrementAge(void) {this->perfData.genomeAge++;}
 
+    // Offspring are held as this genome plus a list of mutations, drawn exactly as mutate()
+    // would apply them, and are only materialised into a genome if they are kept. Screened
+    // offspring are compared with the screen's parent figures, which must be this genome's.
+    // Offspring of a genome holding incremental buffers re-evaluate only the mutated cones on
+    // them, and an adopted offspring copies them, neither is screened or cached
+    void drawMutations(subPopulationAlgorithm& algorithm, std::vector<geneMutation_t>& mutations);
+    bool mutatesActiveGene(std::vector<geneMutation_t> const& mutations) const;
+    bool evaluateOffspring(truthTable& target, std::vector<geneMutation_t> const& mutations,
+                           uint32_t(*ff)(genomePerf_t), uint32_t fitnessBudget, genomePerf_t& perf,
+                           sampleScreen_t const *screen = NULL, fitnessCache *cache = NULL);
+    void adoptOffspring(truthTable& target, genome const& parent,
+                        std::vector<geneMutation_t> const& mutations, genomePerf_t const& perf);
+
+    // Materialise offspring of parent into this genome, keeping the parent's performance
+    // data if the mutations only touch inactive genes
+    void deriveFrom(genome const& parent, std::vector<geneMutation_t> const& mutations);
+
     // Parse genome from an array of genome network frames
     void parseGeneNetworkFrameArray(geneNetworkFrame_t *networkFrameArray);
 
-    // Copy gene data from one genome to this one
-    void copyFrom(genome& g);
+    // Overwrite the listed genes, as unpacked from a transmission buffer
+    void parseGeneList(std::vector<geneMutation_t> const& genes);
+
+    // Copy gene data from one genome to this one, reusing existing storage
+    void copyFrom(genome const& g);
 
     // output genome to file
     void outputToFile(std::string const path);
@@ -220,29 +373,36 @@ class genome {
 class genomeTransmissionBuffer {
   private:
 
-    // Raw data storage buffer
-    geneNetworkFrame_t *buffer;
-    uint32_t currentGenes;
-    uint32_t maxGenes;
+    // Packed genomes, each is an active gene count followed by the active genes
+    // Each gene is a header byte holding the function and the gap from the previous
+    // active gene, then zigzag varints of the distance back to its A and B inputs
+    std::vector<uint8_t> buffer;
+    uint32_t byteCount;
+    uint32_t readPosition;
 
-  private:
-
-    // Append a gene to the buffer
-    void append(geneNetworkFrame_t g);
+    // Genes unpacked from the buffer, reused between genomes
+    std::vector<geneMutation_t> unpackedGenes;
 
-    // Append a gene to the buffer
-    void append(gene g);
+    // Outstanding non-blocking operation
+    MPI_Request request;
+    bool receiving;
 
   public:
 
-    // Constructor
-    genomeTransmissionBuffer(uint32_t bufferLength);
+    // Constructor, room for genomeCount genomes of genomeLength genes
+    genomeTransmissionBuffer(uint32_t genomeLength = 0, uint32_t genomeCount = 1);
 
-    // Get the raw data
-    geneNetworkFrame_t *getData(void);
+    // Empty the buffer and make room for genomeCount genomes of genomeLength genes
+    void reset(uint32_t genomeLength, uint32_t genomeCount = 1);
 
-    // Append a genome to the buffer
-    void append(genome g);
+    // Bytes packed into the buffer
+    uint32_t getByteCount(void) {return this->byteCount;}
+
+    // Append a genome to the buffer, only its active genes are packed if it has been evaluated
+    void append(genome const& g);
+
+    // Unpack the next genome in the buffer over g, genes not packed are left as they were
+    void extract(genome& g);
 
     // Transmit the buffer
     void transmit(int32_t destination, int32_t tag);
@@ -250,8 +410,86 @@ class genomeTransmissionBuffer {
     // Recieve an incoming buffer
     void receive(int32_t source, int32_t tag);
 
-    // Destructor
-    ~genomeTransmissionBuffer(void);
+    // Check for an incoming buffer without receiving it
+    static bool probe(int32_t source, int32_t tag);
+
+    // Non-blocking transmit and receive, the buffer must be left alone until complete
+    void postTransmit(int32_t destination, int32_t tag);
+    void postReceive(int32_t source, int32_t tag);
+    bool isComplete(void);
+    void waitComplete(void);
+};
+
+
+
+//========[FITNESS CACHE]========================================================================//
+
+// Cached bit errors of one compiled active gene list, linked in order of use
+typedef struct {
+  uint64_t key;         // Hash of the compiled program
+  uint64_t check;       // Independent second hash, compared on a hit
+  uint32_t bitErrors;   // Bit errors of the program over the whole table
+  uint32_t newer;       // Entry used next after this one
+  uint32_t older;       // Entry used last before this one
+} fitnessCacheEntry_t;
+
+
+// Bounded cache of bit errors keyed by a hash of the compiled active gene list, so offspring
+// whose active circuit was evaluated before skip the sweep. A hit must match a second,
+// independent hash as well, so a key collision misses rather than returning another circuit's
+// bit errors. The least recently used entry
+// is evicted when full. A cache holds results for one target table, lookups and inserts
+// may come from several threads at once
+class fitnessCache {
+  private:
+
+    // Entries and their index by key, storage is reused once full
+    std::vector<fitnessCacheEntry_t> entries;
+    std::unordered_map<uint64_t, uint32_t> index;
+    uint32_t capacity;
+    uint32_t newest;
+    uint32_t oldest;
+
+    // Hit statistics
+    uint64_t lookupCount;
+    uint64_t hitCount;
+
+    // Held by whichever thread is using the cache, each copy has its own
+    omp_lock_t lock;
+
+  private:
+
+    // Move an entry to the newest end of the use order
+    void unlink(uint32_t i);
+    void pushNewest(uint32_t i);
+
+  public:
+
+    // Constructor, the cache is disabled until given a capacity
+    fitnessCache(void);
+
+    // Copies and moves take the entries and statistics but not the lock. Moves can't throw,
+    // so vectors of subpopulations holding a cache move them rather than copy when they grow
+    fitnessCache(fitnessCache const& other);
+    fitnessCache(fitnessCache&& other) noexcept;
+    fitnessCache& operator=(fitnessCache const& other);
+    fitnessCache& operator=(fitnessCache&& other) noexcept;
+    ~fitnessCache(void);
+
+    // Get and set for the maximum entry count, zero disables the cache
+    uint32_t getCapacity(void) const {return this->capacity;}
+    void setCapacity(uint32_t const c);
+
+    // Drop every entry, as when the target table changes
+    void clear(void);
+
+    // Find the bit errors of a program, or keep them for later
+    bool lookup(uint64_t const key, uint64_t const check, uint32_t& bitErrors);
+    void insert(uint64_t const key, uint64_t const check, uint32_t const bitErrors);
+
+    // Statistics, every lookup that hits saves an evaluation
+    uint64_t getLookupCount(void) const {return this->lookupCount;}
+    uint64_t getHitCount(void) const {return this->hitCount;}
 };
 
 
@@ -278,8 +516,23 @@ class subPopulationAlgorithm {
     uint32_t maxFeedForward;
     std::vector<geneFunction_t> allowableFunctions;
 
+    // Genome evaluation engine and early exit against the worst kept fitness
+    genomeEvaluator_t evaluator;
+    bool earlyExit;
+
+    // Offspring per generation in (1+lambda) mode, zero for steady state selection,
+    // and threads to evaluate them with when subpopulations are iterated one at a time
+    uint32_t lambda;
+    uint32_t threadCount;
+
+    // Bitmaps offspring are screened on before full evaluation, zero to evaluate them in full
+    uint32_t sampleBitmaps;
+
+    // Fitness cache entries per subpopulation, zero to disable it
+    uint32_t fitnessCacheSize;
+
     // Local random number generator
-    std::mt19937 localRandEngine;
+    localRng_t localRandEngine;
 
     // Current tag for transmit operations
     uint32_t txTagCounter;
@@ -321,8 +574,32 @@ class subPopulationAlgorithm {
     std::vector<geneFunction_t> getAllowableFunctions(void) {return this->allowableFunctions;}
     void setAllowableFunctions(std::vector<geneFunction_t> const af) {this->allowableFunctions = af;}
 
+    // Get and set for genome evaluation engine
+    genomeEvaluator_t getEvaluator(void) {return this->evaluator;}
+    void setEvaluator(genomeEvaluator_t const e) {this->evaluator = e;}
+
+    // Get and set for early exit evaluation
+    bool getEarlyExit(void) {return this->earlyExit;}
+    void setEarlyExit(bool const ee) {this->earlyExit = ee;}
+
+    // Get and set for (1+lambda) offspring count
+    uint32_t getLambda(void) {return this->lambda;}
+    void setLambda(uint32_t const l) {this->lambda = l;}
+
+    // Get and set for offspring evaluation thread count
+    uint32_t getThreadCount(void) {return this->threadCount;}
+    void setThreadCount(uint32_t const tc) {this->threadCount = tc;}
+
+    // Get and set for offspring screening sample size
+    uint32_t getSampleBitmaps(void) {return this->sampleBitmaps;}
+    void setSampleBitmaps(uint32_t const sb) {this->sampleBitmaps = sb;}
+
+    // Get and set for fitness cache size
+    uint32_t getFitnessCacheSize(void) {return this->fitnessCacheSize;}
+    void setFitnessCacheSize(uint32_t const fcs) {this->fitnessCacheSize = fcs;}
+
     // Local random number generator
-    int32_t localRand(int32_t minimum, int32_t maximum);
+    int32_t localRand(int32_t minimum, int32_t maximum) {return this->localRandEngine.range(minimum, maximum);}
     void setSeed(uint32_t seed) {this->localRandEngine.seed(seed);}
 
     // Select high and low genome
@@ -352,6 +629,16 @@ typedef struct {
 
 
 
+// Genome migration in flight between processes, kept and reused between cycles
+typedef struct {
+  genomeTransmissionBuffer buffer;
+  std::vector<uint32_t> genomeIndices;    // Destination genome indices of an import
+  bool import;
+  bool active;
+} genomeMigration_t;
+
+
+
 // Class to represent subpopulation of genomes
 class subPopulation {
   private:
@@ -368,16 +655,40 @@ class subPopulation {
     // Population state data
     std::vector<genome> genomes;                     // Raw genome data
     std::vector<genomeFitnessMapping_t> rankMap;     // Genome rank map
+    std::vector<geneMutation_t> mutations;           // Mutations of the child under early exit evaluation
+
+    // (1+lambda) offspring, reused from generation to generation
+    std::vector<genome> offspring;
+    std::vector<std::vector<geneMutation_t>> offspringMutations;
+    std::vector<uint32_t> offspringFitness;
+
+    // Sample offspring are screened on, rotated every generation
+    sampleScreen_t screen;
+    uint32_t sampleRotation;
+    std::vector<uint32_t> sampleErrors;              // Per genome this generation, UINT32_MAX until measured
+
+    // Bit errors of active circuits already evaluated
+    fitnessCache cache;
+
+    // Non-blocking migrations posted by crossover
+    std::vector<genomeMigration_t> migrations;
+
+    // Asynchronous island model elite transmit and migrant recieve buffers
+    genomeTransmissionBuffer eliteBuffer;
+    bool eliteInFlight;
+    genomeTransmissionBuffer migrantBuffer;
 
   private:
 
     // Stuff for sorting the rankmap
-    void swapRankMap(uint32_t i1, uint32_t i2);
     int64_t rankMapSortKey(uint32_t i);
-    int32_t partitionRankMap(int32_t low, int32_t high);
-    void quickSortRankMap(int32_t low, int32_t high);
     void sortRankMap(void);
 
+    // Generation strategies
+    void iterateSteadyState(truthTable& target, uint32_t(*ff)(genomePerf_t));
+    void iterateOnePlusLambda(truthTable& target, uint32_t(*ff)(genomePerf_t));
+    bool updateSampleScreen(truthTable& target);
+
     // Assert checks
     void assertInitialised(std::string msg);
     void assertLocal(std::string msg);
@@ -386,6 +697,7 @@ class subPopulation {
     void parseGenomeBuffer(genomeTransmissionBuffer& buffer, std::vector<uint32_t>& genomeIndices);
     void copyGenomes(std::vector<uint32_t>& genomeIndices, subPopulation& source);
     void importGenomes(std::vector<uint32_t>& genomeIndices, subPopulation& source, uint32_t tag);
+    genomeMigration_t& allocateMigration(uint32_t genomeCount);
     void exportGenomes(std::vector<uint32_t>& genomeIndices, subPopulation& target, uint32_t tag);
 
   public:
@@ -415,11 +727,22 @@ class subPopulation {
     // Get subpopulation performance data
     subPopulationPerf_t getPerfData(void);
 
-    // Subpopulation crossover operator
+    // Subpopulation crossover operator, genomes from other processes arrive once migrations complete
     void crossover(subPopulation& pop1, subPopulation& pop2, std::vector<uint32_t> crossoverIndices, uint32_t tag);
+    void completeMigrations(truthTable& target, uint32_t(*ff)(genomePerf_t));
 
-    // Get a specific genome
-    std::vector<genome> getGenomes(void);
+    // Asynchronous island model migration, the elite replaces the neighbour's worst genome
+    bool pushElite(subPopulation& neighbour, truthTable& target, uint32_t(*ff)(genomePerf_t));
+    uint32_t pullMigrants(subPopulation& source, truthTable& target, uint32_t(*ff)(genomePerf_t));
+    void receiveMigrant(subPopulation& source, truthTable& target, uint32_t(*ff)(genomePerf_t));
+    void completeEliteTransmit(void);
+
+    // Get the genomes
+    std::vector<genome>& getGenomes(void);
+    genomePerf_t getBestGenomePerf(truthTable& target) {return this->rankMap[0].ptr->getPerfData(target);}
+
+    // Get the fitness cache
+    fitnessCache const& getFitnessCache(void) const {return this->cache;}
 
     // Print out the rankmap
     void printRankMap(truthTable& target);
@@ -441,7 +764,7 @@ class populationAlgorithm {
   private:
 
     // Local random number generation
-    std::mt19937 localRandEngine;
+    localRng_t localRandEngine;
 
     // Crossover variables
     uint32_t selectCount;
@@ -461,6 +784,18 @@ class populationAlgorithm {
     uint32_t threadCount;
     uint32_t commTagCounter;
 
+    // Asynchronous island model, elites migrate around a ring of subpopulations with no
+    // collective per cycle, the global best fitness may lag by up to maxStaleness cycles
+    bool asynchronous;
+    uint32_t maxStaleness;
+
+    // Stop criteria, zero disables the numeric ones
+    bool stopOnZeroErrors;                    // Stop once any genome has no bit errors
+    uint32_t stopCost;                        // Stop once an error free genome costs no more than this
+    uint32_t(*stopCostFunction)(genomePerf_t);  // Cost of a genome, active gene count if NULL
+    double stopTime;                          // Wall clock budget in seconds
+    uint32_t stopStagnation;                  // Cycles without improvement in best fitness
+
   public:
 
     // Constructors
@@ -478,7 +813,7 @@ class populationAlgorithm {
     void setGenerationsPerCycle(uint32_t gpc) {this->generationsPerCycle = gpc;}
 
     // Local random number generator
-    int32_t localRand(int32_t minimum, int32_t maximum);
+    int32_t localRand(int32_t minimum, int32_t maximum) {return this->localRandEngine.range(minimum, maximum);}
     void setSeed(uint32_t seed) {this->localRandEngine.seed(seed);}
 
     // Get and set for crossover count
@@ -491,7 +826,7 @@ class populationAlgorithm {
 
     // Get and set for thread count
     int getThreadCount(void) {return this->threadCount;}
-    void setThreadCount(int tc) {this->threadCount = tc;}
+    void setThreadCount(int tc) {this->threadCount = tc; this->subPopAlgorithm.setThreadCount(tc);}
 
     // Select subpopulations
     int32_t randomLowSubPopulation(void);
@@ -500,8 +835,37 @@ class populationAlgorithm {
     // Get a random list of crossover indices
     std::vector<uint32_t> randomCrossoverIndices(void);
 
-    // Generate a new comm tag
-    uint32_t generateCommTag(void) {return this->commTagCounter++;}
+    // Generate a new comm tag, wrapping below the elite migration tags
+    uint32_t generateCommTag(void) {return this->commTagCounter++ % ELITE_MIGRATION_TAG_BASE;}
+
+    // Get and set for the asynchronous island model
+    bool getAsynchronous(void) {return this->asynchronous;}
+    void setAsynchronous(bool const a) {this->asynchronous = a;}
+    uint32_t getMaxStaleness(void) {return this->maxStaleness;}
+    void setMaxStaleness(uint32_t const ms) {this->maxStaleness = ms ? ms : 1;}
+
+    // Get and set for the stop criteria
+    bool getStopOnZeroErrors(void) {return this->stopOnZeroErrors;}
+    void setStopOnZeroErrors(bool const s) {this->stopOnZeroErrors = s;}
+    uint32_t getStopCost(void) {return this->stopCost;}
+    void setStopCost(uint32_t const c, uint32_t(*cf)(genomePerf_t) = NULL) {
+      this->stopCost = c;
+      this->stopCostFunction = cf;
+    }
+    double getStopTime(void) {return this->stopTime;}
+    void setStopTime(double const t) {this->stopTime = t;}
+    uint32_t getStopStagnation(void) {return this->stopStagnation;}
+    void setStopStagnation(uint32_t const n) {this->stopStagnation = n;}
+
+    // Cost of a genome under the stop criteria
+    uint32_t stopCostOf(genomePerf_t const& perf) {
+      return this->stopCostFunction ? this->stopCostFunction(perf) : perf.activeGenes;
+    }
+
+    // True if any stop criterion is set
+    bool hasStopCriteria(void) {
+      return this->stopOnZeroErrors || this->stopCost || this->stopTime > 0 || this->stopStagnation;
+    }
 };
 
 
@@ -523,6 +887,17 @@ typedef struct {
 
 
 
+// Entries of the stop criteria reduction, each is reduced to its minimum over all processes
+typedef enum : uint8_t {
+  STOP_BIT_ERRORS = 0,        // Fewest bit errors of any elite
+  STOP_COST,                  // Lowest cost of any error free elite
+  STOP_FITNESS,               // Best elite fitness
+  STOP_TIME_LEFT,             // Zero once any process is out of time
+  STOP_REDUCTION_LENGTH
+} stopReductionEntry_t;
+
+
+
 // Class to represent whole domain
 // This is a parallel class, data resides on multiple nodes
 class population {
@@ -539,6 +914,26 @@ class population {
     std::vector<subPopulationFitnessMapping_t> rankMap;
     std::vector<uint32_t> rankSubPopulationCounts;
 
+    // Asynchronous island model, migrants sent from and recieved by this process
+    // per destination subpopulation, and the non-blocking global best reduction
+    std::vector<uint32_t> migrantsSent;
+    std::vector<uint32_t> migrantsRecieved;
+    uint32_t cycleCount;
+    uint32_t localBestFitness;
+    uint32_t reducedBestFitness;
+    uint32_t globalBestFitness;
+    MPI_Request globalBestRequest;
+
+    // Stop criteria reduction, posted each cycle and checked the next, so every
+    // process decides to stop on the same cycle without a blocking collective
+    uint32_t stopLocal[STOP_REDUCTION_LENGTH];
+    uint32_t stopReduced[STOP_REDUCTION_LENGTH];
+    MPI_Request stopRequest;
+    double startTime;
+    uint32_t cyclesCompleted;
+    uint32_t stopBestFitness;
+    uint32_t stagnantCycles;
+
   private:
 
     // Error and end if this is not initialised
@@ -551,10 +946,7 @@ class population {
     void iterateSubPopulations(truthTable& target, uint32_t(*ff)(genomePerf_t), uint32_t n);
 
     // Rank map sorting
-    void swapRankMap(uint32_t i1, uint32_t i2);
     int64_t rankMapSortKey(uint32_t i);
-    int32_t partitionRankMap(int32_t low, int32_t high);
-    void quickSortRankMap(int32_t low, int32_t high);
     void sortRankMap(void);
 
     // Rankmap synchonisation and helper routines
@@ -569,6 +961,17 @@ class population {
 
     // Perform single crossover event
     void doSubPopulationCrossover(truthTable& target, uint32_t(*ff)(genomePerf_t));
+    void completeMigrations(truthTable& target, uint32_t(*ff)(genomePerf_t));
+
+    // Asynchronous island model
+    void iterateAsynchronous(truthTable& target, uint32_t(*ff)(genomePerf_t));
+    void exchangeElites(truthTable& target, uint32_t(*ff)(genomePerf_t));
+    void updateGlobalBest(void);
+    void finishAsynchronous(truthTable& target, uint32_t(*ff)(genomePerf_t));
+
+    // Stop criteria
+    void postStopReduction(truthTable& target);
+    bool stopCriteriaMet(truthTable& target);
 
   public:
 
@@ -585,6 +988,15 @@ class population {
     void iterate(truthTable& target, uint32_t(*ff)(genomePerf_t));
     void iterate(truthTable& target, uint32_t(*ff)(genomePerf_t), uint32_t n);
 
+    // Best fitness across all processes, possibly a few cycles old in asynchronous mode
+    uint32_t getGlobalBestFitness(void) {return this->globalBestFitness;}
+
+    // Cycles run by the last call to iterate, fewer than asked for if the stop criteria were met
+    uint32_t getCyclesCompleted(void) {return this->cyclesCompleted;}
+
+    // Fitness cache lookups and hits over every subpopulation of every process
+    void getFitnessCacheStats(uint64_t& lookupCount, uint64_t& hitCount);
+
     // Print the subpopulation rankmap
     void printRankMap(void);
 
@@ -0,0 +1,134 @@
+#ifndef RNG_HPP
+#define RNG_HPP
+
+
+// Standard
+#include "stdint.h"
+#include <random>
+
+
+
+//========[XOSHIRO256**]=========================================================================//
+
+// Number of 32 bit draws generated ahead of use
+#define RNG_BATCH_SIZE 32
+
+
+// xoshiro256** generator, draws are generated in batches and bounded with
+// Lemire's multiply and reject method, so no division on the common path
+class xoshiroRng {
+  private:
+
+    // Generator state
+    uint64_t state[4];
+
+    // Batch of draws waiting to be used
+    uint32_t batch[RNG_BATCH_SIZE];
+    uint32_t batchPosition;
+
+    // Rotate left
+    static inline uint64_t rotl(uint64_t const x, int const k) {
+      return (x << k) | (x >> (64 - k));
+    }
+
+    // Next 64 bit output
+    inline uint64_t next(void) {
+      uint64_t result = rotl(this->state[1] * 5, 7) * 9;
+      uint64_t t = this->state[1] << 17;
+      this->state[2] ^= this->state[0];
+      this->state[3] ^= this->state[1];
+      this->state[1] ^= this->state[2];
+      this->state[0] ^= this->state[3];
+      this->state[2] ^= t;
+      this->state[3] = rotl(this->state[3], 45);
+      return result;
+    }
+
+    // Refill the batch, two draws per output
+    void refill(void) {
+      for(unsigned i = 0; i < RNG_BATCH_SIZE; i += 2) {
+        uint64_t r = this->next();
+        this->batch[i] = r >> 32;
+        this->batch[i + 1] = (uint32_t)r;
+      }
+      this->batchPosition = 0;
+    }
+
+    // Next 32 bit draw
+    inline uint32_t draw(void) {
+      if(this->batchPosition == RNG_BATCH_SIZE) {
+        this->refill();
+      }
+      return this->batch[this->batchPosition++];
+    }
+
+  public:
+
+    // Constructor
+    xoshiroRng(void) {this->seed(0);}
+
+    // Seed, the state is expanded from the seed with splitmix64
+    void seed(uint32_t const s) {
+      uint64_t x = s;
+      for(unsigned i = 0; i < 4; i++) {
+        uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        this->state[i] = z ^ (z >> 31);
+      }
+      this->batchPosition = RNG_BATCH_SIZE;
+    }
+
+    // Uniform integer in [minimum, maximum]
+    inline int32_t range(int32_t const minimum, int32_t const maximum) {
+      uint32_t span = (uint32_t)(maximum - minimum) + 1;
+      uint64_t m = (uint64_t)this->draw() * span;
+      uint32_t low = (uint32_t)m;
+      if(low < span) {
+        uint32_t threshold = (0 - span) % span;
+        while(low < threshold) {
+          m = (uint64_t)this->draw() * span;
+          low = (uint32_t)m;
+        }
+      }
+      return minimum + (int32_t)(m >> 32);
+    }
+};
+
+
+
+//========[MT19937]==============================================================================//
+
+// Standard library Mersenne twister, reproduces runs from before the fast generator
+class mt19937Rng {
+  private:
+
+    // Generator state
+    std::mt19937 engine;
+
+  public:
+
+    // Seed
+    void seed(uint32_t const s) {this->engine.seed(s);}
+
+    // Uniform integer in [minimum, maximum]
+    inline int32_t range(int32_t const minimum, int32_t const maximum) {
+      std::uniform_int_distribution<> distribution(minimum, maximum);
+      return distribution(this->engine);
+    }
+};
+
+
+
+//========[SELECTION]============================================================================//
+
+// Generator used by the algorithms, chosen at compile time so draws inline
+// Build with RNG=mt19937 to get the Mersenne twister
+#ifdef USE_MT19937_RNG
+typedef mt19937Rng localRng_t;
+#else
+typedef xoshiroRng localRng_t;
+#endif
+
+
+#endif // RNG_HPP
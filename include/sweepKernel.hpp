@@ -0,0 +1,73 @@
+#ifndef SWEEP_KERNEL_HPP
+#define SWEEP_KERNEL_HPP
+
+
+// Standard
+#include "stdint.h"
+
+
+// Internal
+#include "mpicga.hpp"
+
+
+
+//========[LANE WIDTH]===========================================================================//
+
+// Sweep evaluator lane widths, value is the number of 64 bit words per gate operation
+typedef enum : uint8_t {
+  LANE_WIDTH_AUTO = 0,
+  LANE_WIDTH_64 = 1,
+  LANE_WIDTH_256 = 4,
+  LANE_WIDTH_512 = 8
+} laneWidth_t;
+
+
+// Widest lane supported by the running CPU
+laneWidth_t supportedLaneWidth(void);
+
+// Force a lane width, auto selects the widest supported width, not from parallel regions
+void setLaneWidth(laneWidth_t const w);
+
+// Get the lane width in use
+laneWidth_t getLaneWidth(void);
+
+
+
+//========[SWEEP KERNEL]=========================================================================//
+
+// Branch free gene function masks, indexed by gene function
+// out = (((a & b) & and) | ((a | b) & or) | ((a ^ b) & xor) | (a & nop)) ^ inv
+typedef struct {
+  uint64_t andMask;
+  uint64_t orMask;
+  uint64_t xorMask;
+  uint64_t nopMask;
+  uint64_t invMask;
+} geneFunctionMasks_t;
+
+extern const geneFunctionMasks_t geneFunctionMasks[8];
+
+
+// Everything a sweep kernel needs to evaluate a compiled genome against a target
+// Scratch slots hold inputs first, followed by active genes in evaluation order
+typedef struct {
+  const geneInstruction_t *program;   // Compiled active gene list
+  uint32_t programLength;
+  uint32_t inputCount;
+  const uint64_t * const *inputs;     // Input bitmap columns, lane padded
+  bool counterInputs;                 // Inputs in counting order, made from the bitmap index
+  uint32_t firstBitmap;               // Table bitmap index of bitmap 0 of the columns
+  uint32_t outputCount;
+  const uint16_t *outputSlots;        // Scratch slot of each output gene
+  const uint64_t * const *outputs;    // Target output bitmap columns, lane padded
+  const uint64_t * const *cares;      // Valid and cared bit masks per output, lane padded
+  uint64_t *scratch;                  // Slot count * LANE_WIDTH_512 words
+} sweepJob_t;
+
+
+// Sum bit errors over bitmaps [firstBitmap, lastBitmap) using the current lane width
+// firstBitmap must be a multiple of the lane width, lastBitmap is rounded up to one
+uint32_t sweepBitErrors(sweepJob_t const& job, uint32_t firstBitmap, uint32_t lastBitmap);
+
+
+#endif // SWEEP_KERNEL_HPP
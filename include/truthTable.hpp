@@ -3,10 +3,10 @@
 
 
 // Standard
-#include <map>
 #include <vector>
 #include <string>
 #include <fstream>
+#include <memory>
 
 
 // Internal
@@ -22,28 +22,143 @@ struct truthTableParseException : public std::exception {
 };
 
 
-// Truth table file pointer
+// Binary truth table files, a header followed by every input then output column in the
+// lane padded bitmap layout used in memory, so they load with a single copy per column
+// Tables with don't care outputs have a care column per output after the outputs
+#define TRUTH_TABLE_BINARY_MAGIC 0x31425454     // "TTB1" read little endian
+#define TRUTH_TABLE_BINARY_VERSION 1
+
+// Binary truth table header, padded to 64 bytes so the columns stay lane aligned
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t inputCount;
+  uint32_t outputCount;
+  uint32_t patternCount;
+  uint32_t laneBitmapCount;         // Words per column
+  uint32_t flags;                   // TRUTH_TABLE_BINARY_FLAG_* bits
+  uint32_t reserved[9];
+} truthTableBinaryHeader_t;
+
+// Binary truth table flags
+#define TRUTH_TABLE_BINARY_FLAG_CARE 0x01       // Care columns follow the outputs
+#define TRUTH_TABLE_BINARY_FLAG_COUNTER 0x02    // Every input pattern in counting order
+
+
+// Bytes of bitmap columns per evaluation block, sized so a block stays in cache
+// while every genome of a batch is swept over it
+#define TRUTH_TABLE_BLOCK_BYTES (256 << 10)
+
+// Bytes of generated blocks of a procedural table kept per thread, lowered to the
+// resident budget shared between threads when one is set
+#define TRUTH_TABLE_GENERATED_BYTES (64 << 20)
+
+
+// Memory mapped binary table file, shared by copies of a table and unmapped with the last
+struct truthTableMapping {
+  void *address;
+  size_t size;
+  truthTableMapping(void *a, size_t s) : address(a), size(s) {}
+  ~truthTableMapping();
+};
+
+
+// Procedural table kernel, outputs are a pure function of the input pattern and the table
+// holds every input pattern in counting order, so nothing needs storing. The shape gives the
+// input and output counts for an operand width, inputs are split into operands LSB first
+typedef struct {
+  std::string name;
+  std::string description;
+  void (*shape)(uint32_t width, uint32_t& inputCount, uint32_t& outputCount);
+  uint32_t (*function)(uint32_t iPattern, uint32_t width);
+} truthTableKernel_t;
+
+// Largest procedural table, pattern counts must fit in 32 bits
+#define TRUTH_TABLE_KERNEL_MAX_INPUTS 31
+
+
+// Input column bitmap of a table holding every input pattern in counting order
+// The low six inputs repeat within a bitmap, higher inputs are constant across one
+static inline uint64_t counterBitmap(uint32_t inputIndex, uint32_t bitmapIndex) {
+  static const uint64_t periodic[6] = {
+    0x5555555555555555ULL, 0x3333333333333333ULL, 0x0f0f0f0f0f0f0f0fULL,
+    0x00ff00ff00ff00ffULL, 0x0000ffff0000ffffULL, 0x00000000ffffffffULL};
+  if(inputIndex < 6) {
+    return periodic[inputIndex];
+  }
+  return (bitmapIndex >> (inputIndex - 6)) & 0x01 ? ~((uint64_t)0) : 0;
+}
+
+
+// Bitmap columns of a block of bitmaps, every pointer starts at the first bitmap of the block
+// Blocks are a whole number of lanes, fully specified tables get valid bit masks as care columns
+// Tables in counting order leave the input pointers NULL, inputs are made with counterBitmap
+typedef struct {
+  uint32_t firstBitmap;
+  uint32_t bitmapCount;
+  bool counterInputs;
+  std::vector<const uint64_t *> inputs;
+  std::vector<const uint64_t *> outputs;
+  std::vector<const uint64_t *> cares;
+  std::vector<uint64_t> validMasks;         // Block local masks for mapped tables
+
+  // Columns of procedural tables, outputs and valid masks. The block is held per
+  // thread and keeps the blocks of the table it generates up to a byte limit, so later
+  // sweeps skip generating them again. Sweeps run in order, so the first blocks are
+  // kept and the rest go through the scratch block
+  std::vector<std::vector<uint64_t>> generated;     // Per block of the table, empty if not kept
+  std::vector<uint64_t> generatedScratch;
+  const truthTableKernel_t *generatedKernel = NULL;
+  uint32_t generatedWidth = 0;
+  uint32_t generatedBlockBitmapCount = 0;
+  uint64_t generatedBytes = 0;
+} truthTableBlock_t;
+
+
+// Truth table file character classes
+#define TTFP_CHAR_WHITESPACE 0x01
+#define TTFP_CHAR_NUMBER 0x02
+#define TTFP_CHAR_NAME 0x04
+#define TTFP_CHAR_DONT_CARE 0x08
+
+
+// Truth table file pointer, the file is read into memory in large chunks and
+// scanned with character class tables, line and column are only worked out for errors
 class TTfp {
   private:
 
-    std::ifstream fp;    // File pointer
-    uint32_t line;
-    uint32_t column;
+    std::vector<char> text;     // File contents
+    uint32_t position;          // Current position within the contents
+
+    // Character class and digit value tables, built from the file format strings
+    static uint8_t charClass[256];
+    static uint8_t digitValue[256];
+    static void buildTables(void);
 
   public:
 
-    TTfp(std::string path);                 // Constructor, opens the file
-    char current(void);                     // Get current character
-    void advance(void);                     // Advance the file pointer by 1 byte
+    TTfp(std::string path);                 // Constructor, reads the file
+
+    // Get current character
+    char current(void) {return this->position < this->text.size() ? this->text[this->position] : EOF;}
+
+    // Advance the file pointer by 1 byte
+    void advance(void) {this->position++;}
+
+    // True if the character belongs to any of the classes
+    static bool isClass(char ch, uint8_t classes) {return charClass[(uint8_t)ch] & classes;}
+
     void assertCurrent(char ch);            // Assert the current character
     void skipLine(void);                    // Skips to end of line
-    void skip(std::string chars);           // Skip over chars of given type
-    std::string get(std::string chars);     // Get a string made up of these chars
+    void skip(uint8_t classes);             // Skip over chars of given classes
+    std::string get(uint8_t classes);       // Get a string made up of chars of these classes
     uint32_t getNumber(uint32_t radix);     // Get number with an arbitrary radix
+    uint32_t getMaskedNumber(uint32_t radix, uint32_t& careMask);    // Number with don't care digits
 
-    // Routines for getting the things vector
-    std::pair<uint32_t, uint32_t> getPattern(uint32_t radix);
-    void getPatternList(std::vector<std::pair<uint32_t, uint32_t>>& patterns, uint32_t radix);
+    // Routines for getting the things vector, output bits outside the care masks are don't cares
+    std::pair<uint32_t, uint32_t> getPattern(uint32_t radix, uint32_t& careMask);
+    void getPatternList(std::vector<std::pair<uint32_t, uint32_t>>& patterns,
+                        std::vector<uint32_t>& careMasks, uint32_t radix);
 
     // Generate line string to indicate where problems occur
     std::string lineString(void);
@@ -52,6 +167,59 @@ class TTfp {
     static const std::string whiteSpaceChars;
     static const std::string numberChars;
     static const std::string nameChars;
+    static const std::string dontCareChars;
+};
+
+
+// Outcome of indexing a pattern
+typedef enum : uint8_t {
+  PATTERN_NEW,          // Input not held before
+  PATTERN_DUPLICATE,    // Adds nothing to the held definition
+  PATTERN_MERGED        // Cares about outputs the held definition didn't, merged into it
+} patternIndexResult_t;
+
+
+// Inputs up to this count may use the dense pattern index
+#define PATTERN_INDEX_DENSE_MAX_INPUTS 26
+
+
+// Index from input pattern to output pattern and care mask, held in the low and high
+// words of each value, and the table row holding the pattern. Only used to catch duplicate,
+// conflicting and mergeable patterns while a table is built. Tables filling at least half of the input space use a
+// seen bitset with an output per possible input, sparser tables an open addressed hash
+class patternIndex {
+  private:
+
+    bool dense;                       // Indexed directly by input pattern
+    uint32_t count;                   // Patterns held
+    uint32_t slotMask;                // Sparse slot count - 1
+    uint32_t slotBits;                // log2 of the sparse slot count
+    std::vector<uint64_t> seen;       // Occupied bit per input pattern (dense) or slot (sparse)
+    std::vector<uint32_t> keys;       // Input pattern per slot, sparse only
+    std::vector<uint64_t> values;     // Output and care mask per input pattern or slot
+    std::vector<uint32_t> rows;       // Table row per input pattern or slot
+
+    void resizeSlots(uint32_t slotCount);   // Rehash into a new number of sparse slots
+
+  public:
+
+    patternIndex(void) : dense(false), count(0), slotMask(0), slotBits(0) {}
+
+    // Size for the expected number of patterns, dropping anything held
+    void reset(uint32_t inputCount, uint32_t expectedCount);
+
+    // Add a pattern held at a table row, if the input is already held returns false with its slot
+    bool insert(uint32_t iPattern, uint64_t value, uint32_t row, uint32_t& slot);
+
+    // Output and care mask, and table row, of a held pattern by the slot insert returned
+    uint64_t getValue(uint32_t slot) {return this->values[slot];}
+    void setValue(uint32_t slot, uint64_t value) {this->values[slot] = value;}
+    uint32_t getRow(uint32_t slot) {return this->rows[slot];}
+
+    // Free the storage
+    void release(void);
+    bool isEmpty(void) {return this->seen.empty();}
+    bool isDense(void) {return this->dense;}
 };
 
 
@@ -59,35 +227,114 @@ class TTfp {
 class truthTable {
   private:
 
-    std::map<uint32_t, uint32_t> patternMap;     // Map of patterns, used for error checking
+    patternIndex index;                          // Index of patterns, used for error checking
     std::vector<bitVector> inputs;               // Vectors containing input patterns
     std::vector<bitVector> outputs;              // Vectors containing output patterns
+    std::vector<bitVector> cares;                // Care bits per output, empty if fully specified
+    std::vector<uint64_t> bitmapMasks;           // Valid bit masks, padded like the bit vectors
+
+    // Binary tables are streamed from their mapping rather than copied, the bit
+    // vectors are then left empty and columns are read through the mapping
+    std::shared_ptr<truthTableMapping> mapping;  // Mapped file, NULL when held in memory
+    const uint64_t *mappedColumns;               // First column within the mapping
+    uint32_t mappedPatternCount;
+    uint64_t residentBudget;                     // Bytes of mapped table kept resident, 0 for no limit
+    uint32_t residentThreadCount;                // Threads sharing the resident budget
+
+    // Procedural tables generate their bitmaps from a kernel as they are needed, the bit
+    // vectors are left empty like those of a mapped table
+    std::shared_ptr<const truthTableKernel_t> kernel;    // NULL unless procedural
+    uint32_t kernelWidth;
+
+    // Tables holding every input pattern in counting order need no input columns to evaluate
+    bool counterInputs;
+
+    void updateBitmapMasks(void);                           // Rebuild masks for the whole table
+    void updateCounterInputs(void);                         // Check for inputs in counting order
+    void readBinaryFile(std::string path);                  // Load from a memory mapped binary file
+    void buildIndex(uint32_t incomingCount);                // Index the existing patterns if not already
+    patternIndexResult_t indexPattern(uint32_t iPattern, uint32_t& oPattern, uint32_t& careMask, uint32_t& row);  // Throws on conflict
+    void mergePattern(uint32_t row, uint32_t oPattern, uint32_t careMask);  // Rewrite the outputs and cares of a row
+    void addCareColumns(void);                              // Start care columns, existing patterns are all cared
+    void generateOutputBitmaps(uint32_t firstBitmap, uint32_t bitmapCount, uint64_t *columns, uint32_t stride);
+    void getGeneratedBlock(truthTableBlock_t& block);        // Fill a block of a procedural table
+    const uint64_t *getCareBitmaps(uint32_t outputIndex);   // Raw care column, tables with don't cares only
+    void advisePages(uint32_t firstBitmap, uint32_t bitmapCount, int advice);    // madvise a range of mapped bitmaps
 
   public:     // Public interface
 
     truthTable(std::string path);                                // Constructor, from file
+    truthTable(std::string path, int32_t root);                  // Constructor, from file parsed by root and broadcast
     truthTable(uint32_t inputCount, uint32_t outputCount);  // Constructor, empty
     void addPattern(uint32_t iPattern, uint32_t oPattern);  // Add a pattern to the target
     void addPattern(std::pair<uint32_t, uint32_t> pattern);      // Add a pattern to the target
+    void addPattern(uint32_t iPattern, uint32_t oPattern, uint32_t careMask);   // Add with don't care outputs
+
+    // Add patterns in bulk, with an optional care mask per pattern
+    // Patterns that care about no outputs are dropped, they can never cost a bit error
+    void addPatterns(std::vector<std::pair<uint32_t, uint32_t>> const& patterns,
+                     std::vector<uint32_t> const& careMasks = std::vector<uint32_t>());
     void assertValid(void);                                 // Errors if table is not valid
+    void releaseIndex(void);                                // Free the pattern index once loaded
 
     // Get for input and output bit counts
     uint32_t getInputCount(void) {return this->inputs.size();}
     uint32_t getOutputCount(void) {return this->outputs.size();}
 
     // Gets for patterns and pattern count
-    uint32_t getPatternCount(void) {return this->patternMap.size();}
+    // Patterns are read back from the bitmaps, the pattern index is not needed
+    uint32_t getPatternCount(void) {
+        if(this->kernel) return ((uint32_t)0x01) << this->getInputCount();
+        return this->mapping ? this->mappedPatternCount : this->inputs[0].getLength();
+    }
     std::pair<uint32_t, uint32_t> getPattern(uint32_t index);
+    uint32_t getCareMask(uint32_t index);
+    bool hasDontCares(void) {return !this->cares.empty();}
+    bool hasCounterInputs(void) {return this->counterInputs;}
 
     // Gets and sets for various bitmap related stuff
-    uint32_t getBitmapCount(void) {return this->inputs[0].getBitmapCount();}
+    uint32_t getBitmapCount(void) {return (this->getPatternCount() + 63) / 64;}
     uint64_t getInputBitmap(uint32_t inputIndex, uint32_t bitmapIndex);
     uint64_t getOutputBitmap(uint32_t outputIndex, uint32_t bitmapIndex);
     uint64_t getBitmapMask(uint32_t bitmapIndex);
+    uint64_t getCareBitmap(uint32_t outputIndex, uint32_t bitmapIndex);    // Valid and cared bits
+
+    // Raw bitmap columns, zero padded to a whole number of 512 bit lanes
+    // Procedural tables have no raw columns until they are explicitly materialised
+    uint32_t getLaneBitmapCount(void);
+    const uint64_t *getInputBitmaps(uint32_t inputIndex);
+    const uint64_t *getOutputBitmaps(uint32_t outputIndex);
+
+    // Block access for evaluation, blocks are sized from the resident budget and the
+    // pages of a mapped table larger than the budget are dropped once a block is released
+    void setResidentBudget(uint64_t bytes, uint32_t threadCount = 1) {
+        this->residentBudget = bytes;
+        this->residentThreadCount = threadCount ? threadCount : 1;
+    }
+    uint64_t getResidentBudget(void) {return this->residentBudget;}
+    bool isMapped(void) {return this->mapping != NULL;}
+    bool isGenerated(void) {return this->kernel != NULL;}
+    void materialise(void);                                 // Copy a mapped or procedural table into memory
+    uint32_t getBlockBitmapCount(void);
+    void getBlock(uint32_t firstBitmap, truthTableBlock_t& block);
+    void releaseBlock(truthTableBlock_t const& block);
 
     // File writing routines
     void writeToFile(std::string path, uint32_t radix);
     void writeToFile(std::string path);
+    void writeBinaryFile(std::string path);
+
+    // True if the file at path is a binary truth table
+    static bool isBinaryFile(std::string path);
+
+    // Procedural tables, from a kernel name and operand width or a "name:width" string
+    static truthTable generate(std::string kernelName, uint32_t width);
+    static truthTable generate(std::string spec);
+
+    // Kernel registry, add, addc, mul, cmp and popcount are built in
+    // A kernel registered under an existing name replaces it
+    static void registerKernel(truthTableKernel_t const& kernel);
+    static std::vector<std::string> getKernelNames(void);
 };
 
 
@@ -31,5 +31,9 @@ int32_t myRank(void);
 int32_t rankCount(void);
 
 
+// Let outstanding non-blocking communication progress
+void progressCommunication(void);
+
+
 
 #endif // UTILS_H
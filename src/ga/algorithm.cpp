@@ -27,6 +27,18 @@ subPopulationAlgorithm::subPopulationAlgorithm(uint32_t genomeCount, uint32_t ge
                               GENE_FN_XOR,
                               GENE_FN_NOT};
 
+  // Default genome evaluation engine
+  this->evaluator = GENOME_EVAL_SWEEP;
+  this->earlyExit = false;
+
+  // Steady state selection by default
+  this->lambda = 0;
+  this->threadCount = 1;
+
+  // Offspring are evaluated in full, without a fitness cache
+  this->sampleBitmaps = 0;
+  this->fitnessCacheSize = 0;
+
   // Default selection and mutation counts
   this->mutateCount = 1;
   this->selectCount = 1;
@@ -71,16 +83,6 @@ void subPopulationAlgorithm::setMaxGateDelays(uint32_t gd) {
 
 
 
-// Rnadom number generation using local number generator
-int32_t subPopulationAlgorithm::localRand(int32_t minimum, int32_t maximum) {
-
-  // Better random code
-  uniform_int_distribution<> distribution(minimum, maximum);
-  return distribution(this->localRandEngine);
-}
-
-
-
 // Generate random high genome index
 // Fit genomes at low indexes (0 = most fit)
 int32_t subPopulationAlgorithm::randomHighGenome(void) {
@@ -180,16 +182,17 @@ populationAlgorithm::populationAlgorithm(uint32_t subPopCount, uint32_t genomeCo
   // Processing behaviour
   this->threadCount = 1;
   this->commTagCounter = 0;
-}
-
-
 
-// Random number generation using local number generator
-int32_t populationAlgorithm::localRand(int32_t minimum, int32_t maximum) {
+  // Synchronous cycles by default
+  this->asynchronous = false;
+  this->maxStaleness = 4;
 
-  // Better random code
-  uniform_int_distribution<> distribution(minimum, maximum);
-  return distribution(this->localRandEngine);
+  // Run every cycle unless told otherwise
+  this->stopOnZeroErrors = false;
+  this->stopCost = 0;
+  this->stopCostFunction = NULL;
+  this->stopTime = 0;
+  this->stopStagnation = 0;
 }
 
 
@@ -0,0 +1,187 @@
+// Standard headers
+#include <iostream>
+using namespace std;
+
+
+// Project headers
+#include "mpicga.hpp"
+#include "utils.hpp"
+
+
+// End of the use order
+#define FITNESS_CACHE_NONE UINT32_MAX
+
+
+
+// Constructor
+fitnessCache::fitnessCache(void) {
+  omp_init_lock(&this->lock);
+  this->capacity = 0;
+  this->lookupCount = 0;
+  this->hitCount = 0;
+  this->clear();
+}
+
+
+
+// Copy constructor, the copy has a lock of its own
+fitnessCache::fitnessCache(fitnessCache const& other) {
+  omp_init_lock(&this->lock);
+  *this = other;
+}
+
+
+
+// Move constructor, the new cache has a lock of its own
+fitnessCache::fitnessCache(fitnessCache&& other) noexcept {
+  omp_init_lock(&this->lock);
+  *this = std::move(other);
+}
+
+
+
+// Copy the entries and statistics, keeping this cache's lock
+fitnessCache& fitnessCache::operator=(fitnessCache const& other) {
+  if(this != &other) {
+    this->entries = other.entries;
+    this->index = other.index;
+    this->capacity = other.capacity;
+    this->newest = other.newest;
+    this->oldest = other.oldest;
+    this->lookupCount = other.lookupCount;
+    this->hitCount = other.hitCount;
+  }
+  return *this;
+}
+
+
+
+// Move the entries and statistics, keeping this cache's lock
+fitnessCache& fitnessCache::operator=(fitnessCache&& other) noexcept {
+  if(this != &other) {
+    this->entries = std::move(other.entries);
+    this->index = std::move(other.index);
+    this->capacity = other.capacity;
+    this->newest = other.newest;
+    this->oldest = other.oldest;
+    this->lookupCount = other.lookupCount;
+    this->hitCount = other.hitCount;
+  }
+  return *this;
+}
+
+
+
+// Destructor
+fitnessCache::~fitnessCache(void) {
+  omp_destroy_lock(&this->lock);
+}
+
+
+
+// Set the maximum entry count, entries are dropped if it changes
+void fitnessCache::setCapacity(uint32_t const c) {
+  if(c != this->capacity) {
+    this->capacity = c;
+    this->clear();
+  }
+}
+
+
+
+// Drop every entry, statistics are kept
+void fitnessCache::clear(void) {
+  omp_set_lock(&this->lock);
+  this->entries.clear();
+  this->index.clear();
+  this->index.reserve(this->capacity);
+  this->newest = this->oldest = FITNESS_CACHE_NONE;
+  omp_unset_lock(&this->lock);
+}
+
+
+
+// Take an entry out of the use order
+void fitnessCache::unlink(uint32_t i) {
+  fitnessCacheEntry_t& e = this->entries[i];
+  if(e.newer == FITNESS_CACHE_NONE) {
+    this->newest = e.older;
+  } else {
+    this->entries[e.newer].older = e.older;
+  }
+  if(e.older == FITNESS_CACHE_NONE) {
+    this->oldest = e.newer;
+  } else {
+    this->entries[e.older].newer = e.newer;
+  }
+}
+
+
+
+// Put an entry at the newest end of the use order
+void fitnessCache::pushNewest(uint32_t i) {
+  fitnessCacheEntry_t& e = this->entries[i];
+  e.newer = FITNESS_CACHE_NONE;
+  e.older = this->newest;
+  if(this->newest == FITNESS_CACHE_NONE) {
+    this->oldest = i;
+  } else {
+    this->entries[this->newest].newer = i;
+  }
+  this->newest = i;
+}
+
+
+
+// Find the bit errors of a program, a hit makes the entry the most recently used
+// An entry whose check doesn't match is another program with the same key, so misses
+bool fitnessCache::lookup(uint64_t const key, uint64_t const check, uint32_t& bitErrors) {
+  if(!this->capacity) {
+    return false;
+  }
+
+  bool hit = false;
+  omp_set_lock(&this->lock);
+  this->lookupCount++;
+  unordered_map<uint64_t, uint32_t>::const_iterator it = this->index.find(key);
+  if(it != this->index.end() && this->entries[it->second].check == check) {
+    this->hitCount++;
+    this->unlink(it->second);
+    this->pushNewest(it->second);
+    bitErrors = this->entries[it->second].bitErrors;
+    hit = true;
+  }
+  omp_unset_lock(&this->lock);
+  return hit;
+}
+
+
+
+// Keep the bit errors of a program, evicting the least recently used entry if full
+void fitnessCache::insert(uint64_t const key, uint64_t const check, uint32_t const bitErrors) {
+  if(!this->capacity) {
+    return;
+  }
+
+  omp_set_lock(&this->lock);
+  uint32_t i;
+  unordered_map<uint64_t, uint32_t>::const_iterator it = this->index.find(key);
+  if(it != this->index.end()) {
+    i = it->second;
+    this->unlink(i);
+  } else if(this->entries.size() < this->capacity) {
+    i = this->entries.size();
+    this->entries.push_back(fitnessCacheEntry_t());
+    this->index[key] = i;
+  } else {
+    i = this->oldest;
+    this->unlink(i);
+    this->index.erase(this->entries[i].key);
+    this->index[key] = i;
+  }
+  this->entries[i].key = key;
+  this->entries[i].check = check;
+  this->entries[i].bitErrors = bitErrors;
+  this->pushNewest(i);
+  omp_unset_lock(&this->lock);
+}
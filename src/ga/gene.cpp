@@ -10,48 +10,10 @@ using namespace std;
 
 
 
-// Constructor, initialises everything to zero
-gene::gene(void) {
-  this->bufValid = false;
-  this->function = GENE_FN_NOP;
-  this->aIndex = 0;
-  this->bIndex = 0;
-  this->buf = 0;
-}
-
-
-
-// Construct a gene from a gene network frame
-gene::gene(geneNetworkFrame_t frame) {
-  this->bufValid = false;
-  this->function = frame.function;
-  this->aIndex = frame.aIndex;
-  this->bIndex = frame.bIndex;
-  this->buf = 0;
-}
-
-
-
-// Gets output buffer, recomputes if neccessary
-uint64_t gene::getOutputBuffer(vector<gene>& genes) {
-  uint64_t aInput, bInput = 0;
-
-  // Check that the input buffer is valid
-  if(!this->bufValid) {
-
-    // Recursively evaluate gene values
-    aInput = genes[this->aIndex].getOutputBuffer(genes);
-    if((this->function != GENE_FN_NOP) && (this->function != GENE_FN_NOT)) {
-      bInput = genes[this->bIndex].getOutputBuffer(genes);
-    }
-
-    // Mark gene output as valid
-    this->buf = this->computeBufferValue(aInput, bInput);
-    this->bufValid = true;
-  }
-
-  // Return the output buffer
-  return this->buf;
+// Constructor, views gene at index within the owning genome
+gene::gene(genome *owner, uint32_t index) {
+  this->owner = owner;
+  this->index = index;
 }
 
 
@@ -60,7 +22,7 @@ uint64_t gene::getOutputBuffer(vector<gene>& genes) {
 uint64_t gene::computeBufferValue(uint64_t a, uint64_t b) {
 
   // Compute value depending on
-  switch(this->function) {
+  switch(this->getGeneFunction()) {
 
     // Logic functions
     case GENE_FN_NOP: return a; break;
@@ -82,31 +44,45 @@ uint64_t gene::computeBufferValue(uint64_t a, uint64_t b) {
 
 
 
-// Function to set gene input
-void gene::overrideBuffer(uint64_t bv) {
-  this->buf = bv;
-  this->bufValid = true;
-}
+// Gets and sets for the gene arrays
+geneFunction_t gene::getGeneFunction(void) {return this->owner->functions[this->index];}
+bool gene::isActive(void) {return this->owner->activeFlags[this->index];}
+uint16_t gene::getAIndex(void) {return this->owner->aIndices[this->index];}
+uint16_t gene::getBIndex(void) {return this->owner->bIndices[this->index];}
+void gene::setFunction(geneFunction_t const fn) {this->owner->functions[this->index] = fn;}
+void gene::setAIndex(uint16_t const a) {this->owner->aIndices[this->index] = a;}
+void gene::setBIndex(uint16_t const b) {this->owner->bIndices[this->index] = b;}
 
 
 
-// Function to randomly mutate the gene
-bool gene::mutate(uint32_t selectedIndex, subPopulationAlgorithm& algorithm) {
+// Randomly mutates one characteristic of a frame for the gene at index
+void gene::mutateFrame(geneNetworkFrame_t& frame, uint32_t index, subPopulationAlgorithm& algorithm) {
 
   // Randomly select gene characteristic to mutate
   switch(algorithm.localRand(0, 2)) {
-    case 0: this->aIndex = algorithm.randomGeneInputIndex(selectedIndex); break;
-    case 1: this->bIndex = algorithm.randomGeneInputIndex(selectedIndex); break;
-    case 2: this->function = algorithm.randomGeneFunction(); break;
+    case 0: frame.aIndex = algorithm.randomGeneInputIndex(index); break;
+    case 1: frame.bIndex = algorithm.randomGeneInputIndex(index); break;
+    case 2: frame.function = algorithm.randomGeneFunction(); break;
     default:
       err("Error, failed gene mutation operation.\n");
       exit(1);
       break;
   }
+}
+
+
+
+// Function to randomly mutate the gene
+bool gene::mutate(subPopulationAlgorithm& algorithm) {
+
+  // Mutate a copy of the gene and write it back
+  geneNetworkFrame_t frame = this->getNetworkFrame();
+  gene::mutateFrame(frame, this->index, algorithm);
+  this->setNetworkFrame(frame);
 
-  // Invalidate output buffer
-  bool previouslyActive = this->bufValid;
-  this->bufValid = false;
+  // Gene is no longer known to be active
+  bool previouslyActive = this->isActive();
+  this->owner->activeFlags[this->index] = 0;
   return previouslyActive;
 }
 
@@ -117,10 +93,19 @@ geneNetworkFrame_t gene::getNetworkFrame(void) {
   geneNetworkFrame_t t;
 
   // Populate the gene template struct
-  t.aIndex = this->aIndex;
-  t.bIndex = this->bIndex;
-  t.function = this->function;
+  t.aIndex = this->getAIndex();
+  t.bIndex = this->getBIndex();
+  t.function = this->getGeneFunction();
 
   // Return the gene template struct
   return t;
 }
+
+
+
+// Set the gene from a transmission template
+void gene::setNetworkFrame(geneNetworkFrame_t const& frame) {
+  this->setAIndex(frame.aIndex);
+  this->setBIndex(frame.bIndex);
+  this->setFunction(frame.function);
+}
@@ -2,6 +2,7 @@
 #include <iostream>
 #include <vector>
 #include <fstream>
+#include <cmath>
 using namespace std;
 
 
@@ -9,28 +10,65 @@ using namespace std;
 #include "bitVector.hpp"
 #include "utils.hpp"
 #include "mpicga.hpp"
+#include "sweepKernel.hpp"
+
+
+// Number of bitmaps swept between fitness budget checks
+#define EARLY_EXIT_CHUNK_BITMAPS 16
+
+
+
+// Evaluation scratch space for the calling thread
+static evaluationScratch_t& threadScratch(void) {
+  static thread_local evaluationScratch_t scratch;
+  return scratch;
+}
+
+
+
+// Compiled programs of a batch of genomes being evaluated on the calling thread
+static vector<evaluationScratch_t>& threadBatchScratch(void) {
+  static thread_local vector<evaluationScratch_t> scratch;
+  return scratch;
+}
+
+
+
+// Incremental buffers displaced while an offspring's cones are evaluated on the calling thread
+static vector<uint64_t>& threadDisplacedBuffers(void) {
+  static thread_local vector<uint64_t> buffers;
+  return buffers;
+}
+
+
+
+// Table block being swept on the calling thread
+static truthTableBlock_t& threadBlock(void) {
+  static thread_local truthTableBlock_t block;
+  return block;
+}
 
 
 
 // Initialisation function
 genome::genome(uint32_t geneCount, subPopulationAlgorithm& algorithm) {
 
-  // Allocate vector for gene information
-  this->genes.clear();
-  for(unsigned i = 0; i < geneCount; i++) {
-    this->genes.push_back(gene());
-  }
+  // Allocate gene arrays
+  this->functions.assign(geneCount, GENE_FN_NOP);
+  this->aIndices.assign(geneCount, 0);
+  this->bIndices.assign(geneCount, 0);
+  this->activeFlags.assign(geneCount, 0);
 
   // Set up each gene
   for(unsigned i = 0; i < geneCount; i++) {
 
     // Randomly select a gene function
-    this->genes[i].setFunction(algorithm.randomGeneFunction());
+    this->functions[i] = algorithm.randomGeneFunction();
 
     // Randomly select input indices, don't do this for gene 0
     if(i) {
-      this->genes[i].setAIndex(algorithm.randomGeneInputIndex(i));
-      this->genes[i].setBIndex(algorithm.randomGeneInputIndex(i));
+      this->aIndices[i] = algorithm.randomGeneInputIndex(i);
+      this->bIndices[i] = algorithm.randomGeneInputIndex(i);
     }
   }
 
@@ -39,12 +77,59 @@ genome::genome(uint32_t geneCount, subPopulationAlgorithm& algorithm) {
 
   // This is the finished
   this->perfDataValid = false;
+
+  // Evaluation engine is specified by the algorithm
+  this->evaluator = algorithm.getEvaluator();
+
+  // Incremental evaluator buffers are built on first evaluation
+  this->geneBufferStride = 0;
+  this->geneBuffersValid = false;
 }
 
 
 
-// Evaluates genome performance and applies returns performance info
+// Evaluates genome performance using the selected evaluation engine
 void genome::updatePerfData(truthTable& target) {
+  switch(this->evaluator) {
+    case GENOME_EVAL_RECURSIVE: this->updatePerfDataRecursive(target); break;
+    case GENOME_EVAL_SWEEP: this->updatePerfDataSweep(target); break;
+    case GENOME_EVAL_INCREMENTAL: this->updatePerfDataIncremental(target); break;
+    default:
+      err("Error, unrecognised genome evaluation engine.\n");
+      break;
+  }
+}
+
+
+
+// Gets a gene output buffer, recursively computing its inputs if neccessary
+uint64_t genome::recursiveOutputBuffer(uint32_t geneIndex, evaluationScratch_t& scratch) {
+  uint64_t aInput, bInput = 0;
+
+  // Check that the buffer is valid
+  if(!scratch.flags[geneIndex]) {
+
+    // Recursively evaluate gene values
+    aInput = this->recursiveOutputBuffer(this->aIndices[geneIndex], scratch);
+    if(!this->isUnary(geneIndex)) {
+      bInput = this->recursiveOutputBuffer(this->bIndices[geneIndex], scratch);
+    }
+
+    // Mark gene output as valid
+    scratch.buffers[geneIndex] = this->getGene(geneIndex).computeBufferValue(aInput, bInput);
+    scratch.flags[geneIndex] = 1;
+  }
+
+  // Return the output buffer
+  return scratch.buffers[geneIndex];
+}
+
+
+
+// Evaluates genome performance by recursively evaluating output genes
+void genome::updatePerfDataRecursive(truthTable& target) {
+  evaluationScratch_t& scratch = threadScratch();
+  uint32_t geneCount = this->getGeneCount();
 
   // Clear genome performance data
   this->perfData.reset();
@@ -52,33 +137,38 @@ void genome::updatePerfData(truthTable& target) {
   // Check that target has inputs and outputs
   target.assertValid();
 
+  // One buffer and validity flag per gene
+  scratch.buffers.resize(geneCount);
+  scratch.flags.resize(geneCount);
+
   // Outer loop iterates over bitmaps
   for(unsigned i = 0; i < target.getBitmapCount(); i++) {
 
     // First loop iterates over genes, invalidating all of the output buffers
-    for(unsigned j = 0; j < this->genes.size(); j++) {
-      this->genes[j].bufValid = false;
+    for(unsigned j = 0; j < geneCount; j++) {
+      scratch.flags[j] = 0;
     }
 
     // Second loop reapplies inputs
     for(unsigned j = 0; j < target.getInputCount(); j++) {
-      this->genes[j].overrideBuffer(target.getInputBitmap(j, i));
+      scratch.buffers[j] = target.getInputBitmap(j, i);
+      scratch.flags[j] = 1;
     }
 
     // Last loop calculates outputs for all output genes
     // Also calculates and sums bit errors.
     // k iterates over output genes
     // j iterates over output target pattern bitmaps
-    uint32_t k = this->genes.size() - target.getOutputCount();
+    uint32_t k = geneCount - target.getOutputCount();
     for(unsigned j = 0; j < target.getOutputCount(); j++) {
       uint64_t buffer, difference;
 
       // Get the buffer for the first output gene
-      buffer = this->genes[k].getOutputBuffer(this->genes);
+      buffer = this->recursiveOutputBuffer(k, scratch);
 
       // Compare it to the target, calculate bit errors
       difference = buffer ^ target.getOutputBitmap(j, i);
-      difference &= target.getBitmapMask(i);
+      difference &= target.getCareBitmap(j, i);
       this->perfData.bitErrors += countBits(difference);
 
       // Increment k for next loop
@@ -86,11 +176,16 @@ void genome::updatePerfData(truthTable& target) {
     }
   }
 
+  // Genes with valid buffers are the active ones
+  for(unsigned i = 0; i < geneCount; i++) {
+    this->activeFlags[i] = scratch.flags[i];
+  }
+
   // Iterate over genome, generate performance data struct
-  for(unsigned i = target.getInputCount(); i < this->genes.size(); i++) {
-    if(this->genes[i].isActive()) {
+  for(unsigned i = target.getInputCount(); i < geneCount; i++) {
+    if(this->activeFlags[i]) {
       this->perfData.activeGenes++;
-      this->perfData.updateFunctionCount(this->genes[i].function, 1);
+      this->perfData.updateFunctionCount(this->functions[i], 1);
     }
   }
 
@@ -100,6 +195,559 @@ void genome::updatePerfData(truthTable& target) {
 
 
 
+// Builds the compiled active gene list
+// Genes only take inputs from lower indices, so a single reverse pass from the
+// output genes marks every active gene, and the list comes out in evaluation order
+void genome::compileProgram(truthTable& target, evaluationScratch_t& scratch) {
+  uint32_t geneCount = this->getGeneCount();
+  uint32_t inputCount = target.getInputCount();
+  uint32_t firstOutput = geneCount - target.getOutputCount();
+  vector<uint8_t>& active = scratch.flags;
+  vector<uint16_t>& slots = scratch.slots;
+  active.assign(geneCount, 0);
+  slots.assign(geneCount, 0);
+
+  // Output genes are active by definition
+  for(unsigned i = firstOutput; i < geneCount; i++) {
+    active[i] = 1;
+  }
+
+  // Propagate activity towards the inputs
+  for(unsigned i = geneCount; i-- > inputCount;) {
+    if(active[i]) {
+      active[this->aIndices[i]] = 1;
+      if(!this->isUnary(i)) {
+        active[this->bIndices[i]] = 1;
+      }
+    }
+  }
+
+  // Emit instructions for active non-input genes, inputs count as active
+  // Inputs occupy the first slots, active genes are packed in after them
+  scratch.program.clear();
+  scratch.slotCount = inputCount;
+  for(unsigned i = 0; i < geneCount; i++) {
+    if(i < inputCount) {
+      active[i] = 1;
+      slots[i] = i;
+    } else if(active[i]) {
+      geneInstruction_t inst;
+      slots[i] = scratch.slotCount++;
+      inst.aIndex = slots[this->aIndices[i]];
+      inst.bIndex = this->isUnary(i) ? inst.aIndex : slots[this->bIndices[i]];
+      inst.outIndex = slots[i];
+      inst.function = this->functions[i];
+      scratch.program.push_back(inst);
+    }
+  }
+
+  // Slots holding the output genes
+  scratch.outputSlots.clear();
+  for(unsigned i = firstOutput; i < geneCount; i++) {
+    scratch.outputSlots.push_back(slots[i]);
+  }
+}
+
+
+
+// Fitness cache key of a compiled program, programs are the same circuit whatever the gene
+// positions, as slots are numbered in evaluation order and unary genes repeat input A
+static uint64_t programKey(evaluationScratch_t const& program) {
+  uint64_t key = program.program.size();
+  for(unsigned i = 0; i < program.program.size(); i++) {
+    geneInstruction_t const& inst = program.program[i];
+    uint64_t word = ((uint64_t)inst.function << 32) | ((uint64_t)inst.aIndex << 16) | inst.bIndex;
+    key = (key ^ word) * 0x9e3779b97f4a7c15ULL;
+    key ^= key >> 29;
+  }
+  for(unsigned i = 0; i < program.outputSlots.size(); i++) {
+    key = (key ^ program.outputSlots[i]) * 0xbf58476d1ce4e5b9ULL;
+    key ^= key >> 31;
+  }
+  return key;
+}
+
+
+
+// Second fitness cache hash of a compiled program, FNV-1a over its fields so that it is
+// independent of the key, a hit must match both
+static uint64_t programCheck(evaluationScratch_t const& program) {
+  uint64_t check = 0xcbf29ce484222325ULL;
+  for(unsigned i = 0; i < program.program.size(); i++) {
+    geneInstruction_t const& inst = program.program[i];
+    check = (check ^ inst.function) * 0x100000001b3ULL;
+    check = (check ^ inst.aIndex) * 0x100000001b3ULL;
+    check = (check ^ inst.bIndex) * 0x100000001b3ULL;
+  }
+  for(unsigned i = 0; i < program.outputSlots.size(); i++) {
+    check = (check ^ program.outputSlots[i]) * 0x100000001b3ULL;
+  }
+  return check;
+}
+
+
+
+// Fills in everything but bit errors from a compiled program and sets up its sweep job
+// The slot buffer must hold one widest lane per slot, every slot is written before it is read
+static void prepareSweep(evaluationScratch_t const& program, genomePerf_t& perf, sweepJob_t& job, uint64_t *slotBuffer) {
+  perf.activeGenes = program.program.size();
+  for(unsigned i = 0; i < program.program.size(); i++) {
+    perf.updateFunctionCount(program.program[i].function, 1);
+  }
+  job.program = program.program.data();
+  job.programLength = program.program.size();
+  job.outputSlots = program.outputSlots.data();
+  job.scratch = slotBuffer;
+}
+
+
+
+// Points a sweep job at the columns of a table block
+static void bindBlock(truthTableBlock_t const& block, sweepJob_t& job) {
+  job.inputCount = block.inputs.size();
+  job.inputs = block.inputs.data();
+  job.counterInputs = block.counterInputs;
+  job.firstBitmap = block.firstBitmap;
+  job.outputCount = block.outputs.size();
+  job.outputs = block.outputs.data();
+  job.cares = block.cares.data();
+}
+
+
+
+// Sweeps one table block, adding to the bit errors in perf
+// Given a fitness function, returns false as soon as the fitness must exceed the budget
+// (fitness functions are assumed never to decrease as bit errors increase)
+static bool sweepBlock(truthTableBlock_t const& block, sweepJob_t& job, genomePerf_t& perf,
+                       uint32_t(*ff)(genomePerf_t), uint32_t fitnessBudget) {
+  bindBlock(block, job);
+
+  // Without a budget, sweep the block in one go
+  if(ff == NULL) {
+    perf.bitErrors += sweepBitErrors(job, 0, block.bitmapCount);
+    return true;
+  }
+
+  // Sweep in chunks, checking the partial fitness against the budget
+  for(unsigned i = 0; i < block.bitmapCount; i += EARLY_EXIT_CHUNK_BITMAPS) {
+    uint32_t last = min(i + EARLY_EXIT_CHUNK_BITMAPS, block.bitmapCount);
+    perf.bitErrors += sweepBitErrors(job, i, last);
+    if(ff(perf) > fitnessBudget) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+
+// Sweeps prepared jobs over the sampled lanes alone, giving the bit errors of each on the sample
+// Lanes are read through the table blocks holding them, so blocks are cached as in a full sweep
+static void sweepSample(truthTable& target, vector<uint32_t> const& sample,
+                        sweepJob_t *jobs, uint32_t *sampleErrors, unsigned jobCount) {
+  truthTableBlock_t& block = threadBlock();
+  uint32_t blockBitmapCount = target.getBlockBitmapCount();
+  fill(sampleErrors, sampleErrors + jobCount, 0);
+
+  // Sweep each lane, moving on to the next block when the lane lies beyond this one
+  bool held = false;
+  for(unsigned i = 0; i < sample.size(); i++) {
+    uint32_t first = sample[i] / blockBitmapCount * blockBitmapCount;
+    if(!held || block.firstBitmap != first) {
+      if(held) {
+        target.releaseBlock(block);
+      }
+      target.getBlock(first, block);
+      held = true;
+      for(unsigned j = 0; j < jobCount; j++) {
+        bindBlock(block, jobs[j]);
+      }
+    }
+    uint32_t lane = sample[i] - first;
+    uint32_t last = min(lane + BITVECTOR_LANE_WORDS, block.bitmapCount);
+    for(unsigned j = 0; j < jobCount; j++) {
+      sampleErrors[j] += sweepBitErrors(jobs[j], lane, last);
+    }
+  }
+  if(held) {
+    target.releaseBlock(block);
+  }
+}
+
+
+
+// Sweeps a compiled program over the sampled lanes alone
+static uint32_t sweepProgramSample(truthTable& target, evaluationScratch_t& program, vector<uint32_t> const& sample) {
+  program.buffers.resize((size_t)program.slotCount * LANE_WIDTH_512);
+  genomePerf_t perf;
+  perf.reset();
+  sweepJob_t job;
+  prepareSweep(program, perf, job, program.buffers.data());
+  uint32_t sampleErrors;
+  sweepSample(target, sample, &job, &sampleErrors, 1);
+  return sampleErrors;
+}
+
+
+
+// Offspring bit errors over the whole table estimated from the sample, the parent's plus the
+// change on the sample scaled up to the table, never fewer than were seen on the sample
+static uint32_t estimateBitErrors(sampleScreen_t const& screen, uint32_t parentBitErrors,
+                                  uint32_t parentSampleErrors, uint32_t sampleErrors) {
+  double estimate = parentBitErrors + ((double)sampleErrors - parentSampleErrors) * screen.scale;
+  return max(sampleErrors, (uint32_t)max(0.0, round(estimate)));
+}
+
+
+
+// Sweeps a compiled program over all bitmaps a table block at a time, filling in perf
+// Given a fitness function, the sweep stops as soon as the fitness must exceed the budget
+bool genome::sweepProgram(truthTable& target, evaluationScratch_t& scratch, genomePerf_t& perf,
+                          uint32_t(*ff)(genomePerf_t), uint32_t fitnessBudget) {
+  scratch.buffers.resize((size_t)scratch.slotCount * LANE_WIDTH_512);
+  sweepJob_t job;
+  prepareSweep(scratch, perf, job, scratch.buffers.data());
+
+  // Sweep every block
+  truthTableBlock_t& block = threadBlock();
+  for(uint32_t first = 0; first < target.getBitmapCount(); first += block.bitmapCount) {
+    target.getBlock(first, block);
+    bool within = sweepBlock(block, job, perf, ff, fitnessBudget);
+    target.releaseBlock(block);
+    if(!within) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+
+// Evaluates every genome of the batch that lacks performance data, block major, so each
+// table block is swept by the whole batch while it is in cache and a streamed table is
+// read once per batch rather than once per genome. Given a fitness function, genomes are
+// dropped from the sweep once they must exceed the budget and are left unevaluated.
+// Given a sample screen as well, genomes are first swept over the sample and only those
+// whose estimated fitness is within budget go on to the full sweep. Genomes found in the
+// fitness cache aren't swept at all
+void genome::evaluateBatch(truthTable& target, vector<genome *> const& genomes,
+                           uint32_t(*ff)(genomePerf_t), uint32_t fitnessBudget,
+                           sampleScreen_t const *screen, fitnessCache *cache) {
+  vector<evaluationScratch_t>& programs = threadBatchScratch();
+  evaluationScratch_t& scratch = threadScratch();
+  vector<genome *> batch;
+
+  // Genomes without a sweep evaluator are evaluated on their own
+  for(unsigned i = 0; i < genomes.size(); i++) {
+    genome *g = genomes[i];
+    if(g->perfDataValid) {
+      continue;
+    } else if(g->evaluator != GENOME_EVAL_SWEEP) {
+      if(ff) g->evaluateWithinBudget(target, ff, fitnessBudget); else g->updatePerfData(target);
+    } else {
+      batch.push_back(g);
+    }
+  }
+  if(batch.empty()) {
+    return;
+  }
+
+  // Check that target has inputs and outputs
+  target.assertValid();
+
+  // Compile every program, they share one slot buffer as genomes are swept in turn
+  if(programs.size() < batch.size()) {
+    programs.resize(batch.size());
+  }
+  uint32_t slotCount = 0;
+  for(unsigned i = 0; i < batch.size(); i++) {
+    batch[i]->compileProgram(target, programs[i]);
+    batch[i]->activeFlags.assign(programs[i].flags.begin(), programs[i].flags.end());
+    slotCount = max(slotCount, programs[i].slotCount);
+  }
+  scratch.buffers.resize((size_t)slotCount * LANE_WIDTH_512);
+  vector<sweepJob_t> jobs(batch.size());
+  vector<uint8_t> within(batch.size(), 1);
+  for(unsigned i = 0; i < batch.size(); i++) {
+    batch[i]->perfData.reset();
+    prepareSweep(programs[i], batch[i]->perfData, jobs[i], scratch.buffers.data());
+  }
+
+  // Cached genomes take their bit errors from the cache and drop out of the batch
+  vector<uint64_t> keys(cache ? batch.size() : 0);
+  vector<uint64_t> checks(cache ? batch.size() : 0);
+  if(cache) {
+    vector<genome *> swept;
+    vector<sweepJob_t> sweptJobs;
+    for(unsigned i = 0; i < batch.size(); i++) {
+      keys[swept.size()] = programKey(programs[i]);
+      checks[swept.size()] = programCheck(programs[i]);
+      if(cache->lookup(keys[swept.size()], checks[swept.size()], batch[i]->perfData.bitErrors)) {
+        batch[i]->perfDataValid = true;
+      } else {
+        swept.push_back(batch[i]);
+        sweptJobs.push_back(jobs[i]);
+      }
+    }
+    batch.swap(swept);
+    jobs.swap(sweptJobs);
+    within.resize(batch.size());
+    if(batch.empty()) {
+      return;
+    }
+  }
+
+  // Screen on the sample, the estimate takes everything but bit errors from the compiled program
+  if(screen && ff) {
+    vector<uint32_t> sampleErrors(batch.size());
+    sweepSample(target, screen->bitmaps, jobs.data(), sampleErrors.data(), batch.size());
+    for(unsigned i = 0; i < batch.size(); i++) {
+      genomePerf_t estimate = batch[i]->perfData;
+      estimate.bitErrors = estimateBitErrors(*screen, screen->parentBitErrors,
+                                             screen->parentSampleErrors, sampleErrors[i]);
+      within[i] = ff(estimate) <= fitnessBudget;
+    }
+  }
+
+  // Sweep block by block, genomes over budget drop out
+  truthTableBlock_t& block = threadBlock();
+  for(uint32_t first = 0; first < target.getBitmapCount(); first += block.bitmapCount) {
+    target.getBlock(first, block);
+    for(unsigned i = 0; i < batch.size(); i++) {
+      if(within[i]) {
+        within[i] = sweepBlock(block, jobs[i], batch[i]->perfData, ff, fitnessBudget);
+      }
+    }
+    target.releaseBlock(block);
+  }
+
+  // Performance data is only valid for genomes swept to completion, those are cached
+  for(unsigned i = 0; i < batch.size(); i++) {
+    batch[i]->perfDataValid = within[i];
+    if(cache && within[i]) {
+      cache->insert(keys[i], checks[i], batch[i]->perfData.bitErrors);
+    }
+  }
+}
+
+
+
+// Evaluates genome performance with a flat forward sweep over the active gene list
+bool genome::updatePerfDataSweep(truthTable& target, uint32_t(*ff)(genomePerf_t), uint32_t fitnessBudget) {
+
+  // Clear genome performance data
+  this->perfData.reset();
+
+  // Check that target has inputs and outputs
+  target.assertValid();
+
+  // Build the active gene list once for all bitmaps, mirror activity into the genome
+  evaluationScratch_t& scratch = threadScratch();
+  this->compileProgram(target, scratch);
+  this->activeFlags.assign(scratch.flags.begin(), scratch.flags.end());
+
+  // Performance data is only valid if the sweep ran to completion
+  this->perfDataValid = this->sweepProgram(target, scratch, this->perfData, ff, fitnessBudget);
+  return this->perfDataValid;
+}
+
+
+
+// Evaluates the genome against a fitness budget
+bool genome::evaluateWithinBudget(truthTable& target, uint32_t(*ff)(genomePerf_t), uint32_t fitnessBudget) {
+
+  // Only the sweep evaluator can stop part way through
+  if(!this->perfDataValid) {
+    if(this->evaluator == GENOME_EVAL_SWEEP) {
+      return this->updatePerfDataSweep(target, ff, fitnessBudget);
+    } else {
+      this->updatePerfData(target);
+    }
+  }
+
+  // Compare the complete fitness against the budget
+  return ff(this->perfData) <= fitnessBudget;
+}
+
+
+
+// Recomputes the output buffer of a gene over all bitmaps from its input gene buffers
+// Returns true if any bitmap of the buffer changed
+bool genome::evaluateGeneBuffer(uint32_t geneIndex) {
+  geneFunctionMasks_t const& m = geneFunctionMasks[this->functions[geneIndex] & 0x07];
+  uint32_t stride = this->geneBufferStride;
+
+  // Unary functions ignore input B
+  uint32_t aIndex = this->aIndices[geneIndex];
+  uint32_t bIndex = this->isUnary(geneIndex) ? aIndex : this->bIndices[geneIndex];
+
+  // Input and output bitmaps for this gene
+  const uint64_t *a = &this->geneBuffers[aIndex * stride];
+  const uint64_t *b = &this->geneBuffers[bIndex * stride];
+  uint64_t *out = &this->geneBuffers[geneIndex * stride];
+
+  // Compute new buffer, accumulating differences from the old one
+  uint64_t changed = 0;
+  for(unsigned k = 0; k < stride; k++) {
+    uint64_t v = (((a[k] & b[k]) & m.andMask) |
+                  ((a[k] | b[k]) & m.orMask) |
+                  ((a[k] ^ b[k]) & m.xorMask) |
+                  (a[k] & m.nopMask)) ^ m.invMask;
+    changed |= v ^ out[k];
+    out[k] = v;
+  }
+
+  return changed != 0;
+}
+
+
+
+// Counts bit errors of a single output gene over all bitmaps
+uint32_t genome::outputBitErrors(truthTable& target, uint32_t outputIndex) {
+  uint32_t stride = this->geneBufferStride;
+  uint32_t geneIndex = this->getGeneCount() - target.getOutputCount() + outputIndex;
+  const uint64_t *buf = &this->geneBuffers[geneIndex * stride];
+
+  uint32_t bitErrors = 0;
+  for(unsigned k = 0; k < stride; k++) {
+    uint64_t difference = (buf[k] ^ target.getOutputBitmap(outputIndex, k)) & target.getCareBitmap(outputIndex, k);
+    bitErrors += countBits(difference);
+  }
+
+  return bitErrors;
+}
+
+
+
+// Evaluates every gene over every bitmap, active or not, and caches the results
+void genome::rebuildGeneBuffers(truthTable& target) {
+  uint32_t geneCount = this->getGeneCount();
+  uint32_t inputCount = target.getInputCount();
+
+  // One buffer of bitmapCount words per gene
+  this->geneBufferStride = target.getBitmapCount();
+  this->geneBuffers.assign((size_t)geneCount * this->geneBufferStride, 0);
+
+  // Input genes take their buffers from the target
+  for(unsigned i = 0; i < inputCount && i < geneCount; i++) {
+    for(unsigned k = 0; k < this->geneBufferStride; k++) {
+      this->geneBuffers[i * this->geneBufferStride + k] = target.getInputBitmap(i, k);
+    }
+  }
+
+  // Remaining genes in order
+  for(unsigned i = inputCount; i < geneCount; i++) {
+    this->evaluateGeneBuffer(i);
+  }
+
+  // Per output bit errors
+  this->outputErrors.assign(target.getOutputCount(), 0);
+  for(unsigned j = 0; j < target.getOutputCount(); j++) {
+    this->outputErrors[j] = this->outputBitErrors(target, j);
+  }
+
+  // Buffers are now up to date
+  this->dirtyGenes.clear();
+  this->geneBuffersValid = true;
+}
+
+
+
+// Re-evaluates the fan-out cones of the listed genes in the gene buffers, returning the bit
+// errors that result. Unless kept, the displaced buffers are restored afterwards and the per
+// output bit errors are left as they were
+uint32_t genome::updateGeneCones(truthTable& target, vector<uint16_t> const& genes, bool keep) {
+  uint32_t geneCount = this->getGeneCount();
+  uint32_t inputCount = target.getInputCount();
+  uint32_t stride = this->geneBufferStride;
+  vector<uint8_t> dirty(geneCount, 0);
+  vector<uint8_t> changed(geneCount, 0);
+
+  // Mark mutated genes and find the start of the cone
+  uint32_t first = geneCount;
+  for(unsigned i = 0; i < genes.size(); i++) {
+    dirty[genes[i]] = 1;
+    if(genes[i] < first) first = genes[i];
+  }
+  if(first < inputCount) first = inputCount;
+
+  // Forward sweep, a gene is recomputed if it mutated or one of its inputs changed
+  // propagation stops wherever a recomputed buffer matches the old one
+  vector<uint64_t>& displaced = threadDisplacedBuffers();
+  vector<uint32_t> displacedGenes;
+  displaced.clear();
+  for(unsigned i = first; i < geneCount; i++) {
+    if(dirty[i] || changed[this->aIndices[i]] || (!this->isUnary(i) && changed[this->bIndices[i]])) {
+      if(!keep) {
+        const uint64_t *buf = &this->geneBuffers[(size_t)i * stride];
+        displaced.insert(displaced.end(), buf, buf + stride);
+        displacedGenes.push_back(i);
+      }
+      changed[i] = this->evaluateGeneBuffer(i);
+    }
+  }
+
+  // Recount errors for changed outputs only
+  uint32_t bitErrors = 0;
+  uint32_t firstOutput = geneCount - target.getOutputCount();
+  for(unsigned j = 0; j < target.getOutputCount(); j++) {
+    uint32_t outputErrors = changed[firstOutput + j] ? this->outputBitErrors(target, j) : this->outputErrors[j];
+    if(keep) {
+      this->outputErrors[j] = outputErrors;
+    }
+    bitErrors += outputErrors;
+  }
+
+  // Put back the displaced buffers
+  for(unsigned i = 0; i < displacedGenes.size(); i++) {
+    std::copy(&displaced[(size_t)i * stride], &displaced[(size_t)(i + 1) * stride],
+              &this->geneBuffers[(size_t)displacedGenes[i] * stride]);
+  }
+
+  return bitErrors;
+}
+
+
+
+// Evaluates genome performance, re-simulating only the fan-out cones of mutated genes
+void genome::updatePerfDataIncremental(truthTable& target) {
+
+  // Clear genome performance data
+  this->perfData.reset();
+
+  // Check that target has inputs and outputs
+  target.assertValid();
+
+  // Full evaluation if there are no usable buffers, otherwise propagate changes
+  if(!this->geneBuffersValid || this->geneBufferStride != target.getBitmapCount()) {
+    this->rebuildGeneBuffers(target);
+  } else if(this->dirtyGenes.size()) {
+    this->updateGeneCones(target, this->dirtyGenes, true);
+    this->dirtyGenes.clear();
+  }
+
+  // Sum bit errors
+  for(unsigned j = 0; j < this->outputErrors.size(); j++) {
+    this->perfData.bitErrors += this->outputErrors[j];
+  }
+
+  // Activity and function counts come from the active gene list
+  evaluationScratch_t& scratch = threadScratch();
+  this->compileProgram(target, scratch);
+  this->activeFlags.assign(scratch.flags.begin(), scratch.flags.end());
+  this->perfData.activeGenes = scratch.program.size();
+  for(unsigned i = 0; i < scratch.program.size(); i++) {
+    this->perfData.updateFunctionCount(scratch.program[i].function, 1);
+  }
+
+  // Indicate that performance data is now valid
+  this->perfDataValid = true;
+}
+
+
+
 // Get performance data
 genomePerf_t genome::getPerfData(truthTable& target) {
 
@@ -121,12 +769,21 @@ void genome::mutate(subPopulationAlgorithm& algorithm) {
   for(unsigned i = 0; i < algorithm.getMutateCount(); i++) {
 
     // Select a gene at random to mutate
-    int32_t selectedGeneIdx = algorithm.localRand(1, this->genes.size() - 1);
+    int32_t selectedGeneIdx = algorithm.localRand(1, this->getGeneCount() - 1);
 
     // New mutate code
-    if(this->genes[selectedGeneIdx].mutate(selectedGeneIdx, algorithm)) {
+    if(this->getGene(selectedGeneIdx).mutate(algorithm)) {
       this->perfDataValid = false;
     }
+
+    // Cached gene buffers need the cone of this gene re-evaluating, active or not
+    if(this->geneBuffersValid) {
+      if(this->dirtyGenes.size() < this->getGeneCount()) {
+        this->dirtyGenes.push_back(selectedGeneIdx);
+      } else {
+        this->invalidateGeneBuffers();
+      }
+    }
   }
 
   // Invalidate the performance data (assumes mutation generated bit errors)
@@ -135,44 +792,264 @@ void genome::mutate(subPopulationAlgorithm& algorithm) {
 
 
 
+// Draw the mutations mutate() would make, without applying them
+void genome::drawMutations(subPopulationAlgorithm& algorithm, vector<geneMutation_t>& mutations) {
+  mutations.clear();
+
+  // Iterate
+  for(unsigned i = 0; i < algorithm.getMutateCount(); i++) {
+    geneMutation_t m;
+
+    // Select a gene at random to mutate
+    m.index = algorithm.localRand(1, this->getGeneCount() - 1);
+
+    // Start from the latest version of the gene, it may already have been mutated
+    m.frame = this->getGene(m.index).getNetworkFrame();
+    for(unsigned j = mutations.size(); j-- > 0;) {
+      if(mutations[j].index == m.index) {
+        m.frame = mutations[j].frame;
+        break;
+      }
+    }
+
+    // Mutate the frame
+    gene::mutateFrame(m.frame, m.index, algorithm);
+    mutations.push_back(m);
+  }
+}
+
+
+
+// Checks whether any of the mutations touch a gene active in this genome
+// Genomes without valid performance data are assumed to be affected
+bool genome::mutatesActiveGene(vector<geneMutation_t> const& mutations) const {
+  if(!this->perfDataValid) {
+    return true;
+  }
+  for(unsigned i = 0; i < mutations.size(); i++) {
+    if(this->activeFlags[mutations[i].index]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+
+
+// Overwrite genes with the given mutations, in order
+void genome::applyMutations(vector<geneMutation_t> const& mutations) {
+  for(unsigned i = 0; i < mutations.size(); i++) {
+    this->getGene(mutations[i].index).setNetworkFrame(mutations[i].frame);
+  }
+}
+
+
+
+// Bit errors over the sampled lanes alone, listed by the first bitmap of each lane
+uint32_t genome::sampleBitErrors(truthTable& target, vector<uint32_t> const& sample) {
+
+  // Check that target has inputs and outputs
+  target.assertValid();
+
+  // Compile and sweep the sample
+  evaluationScratch_t& scratch = threadScratch();
+  this->compileProgram(target, scratch);
+  return sweepProgramSample(target, scratch, sample);
+}
+
+
+
+// Evaluates the offspring made by applying mutations to this genome, against a fitness budget
+// The mutations are undone before returning, this genome's own state is left untouched
+// Given a sample screen holding this genome's figures, the offspring is only swept in full if
+// its fitness estimated from the sample is within budget. Given a fitness cache, an
+// offspring whose compiled program is cached isn't swept at all
+bool genome::evaluateOffspring(truthTable& target, vector<geneMutation_t> const& mutations,
+                               uint32_t(*ff)(genomePerf_t), uint32_t fitnessBudget, genomePerf_t& perf,
+                               sampleScreen_t const *screen, fitnessCache *cache) {
+  evaluationScratch_t& scratch = threadScratch();
+
+  // Mutations confined to inactive genes leave the performance unchanged
+  if(!this->mutatesActiveGene(mutations)) {
+    perf = this->perfData;
+    perf.genomeAge = 0;
+    return ff(perf) <= fitnessBudget;
+  }
+
+  // Clear offspring performance data
+  perf.reset();
+
+  // Check that target has inputs and outputs
+  target.assertValid();
+
+  // Temporarily apply the mutations, remembering the genes they displace
+  scratch.undo.clear();
+  for(unsigned i = 0; i < mutations.size(); i++) {
+    geneMutation_t previous;
+    previous.index = mutations[i].index;
+    previous.frame = this->getGene(previous.index).getNetworkFrame();
+    scratch.undo.push_back(previous);
+    this->getGene(previous.index).setNetworkFrame(mutations[i].frame);
+  }
+
+  // Compile the offspring, one whose program is cached takes its bit errors from the cache
+  // A parent holding incremental buffers instead re-evaluates only the mutated cones on them
+  this->compileProgram(target, scratch);
+  bool incremental = this->hasCurrentGeneBuffers(target);
+  uint64_t key = cache && !incremental ? programKey(scratch) : 0;
+  uint64_t check = cache && !incremental ? programCheck(scratch) : 0;
+  bool cached = cache && !incremental && cache->lookup(key, check, perf.bitErrors);
+  if(cached || incremental) {
+    sweepJob_t job;
+    prepareSweep(scratch, perf, job, NULL);
+  }
+  if(incremental) {
+    vector<uint16_t> mutated;
+    for(unsigned i = 0; i < mutations.size(); i++) {
+      mutated.push_back(mutations[i].index);
+    }
+    perf.bitErrors = this->updateGeneCones(target, mutated, false);
+  }
+
+  // Screen on the sample, comparing with the parent's figures
+  bool kept = true;
+  if(screen && !cached && !incremental) {
+    genomePerf_t estimate;
+    estimate.reset();
+    sweepJob_t job;
+    prepareSweep(scratch, estimate, job, NULL);
+    uint32_t sampleErrors = sweepProgramSample(target, scratch, screen->bitmaps);
+    estimate.bitErrors = estimateBitErrors(*screen, screen->parentBitErrors, screen->parentSampleErrors, sampleErrors);
+    kept = ff(estimate) <= fitnessBudget;
+  }
+
+  // Sweep the offspring in full if it survived and wasn't cached, complete sweeps are cached
+  if(cached || incremental) {
+    kept = ff(perf) <= fitnessBudget;
+  } else if(kept) {
+    kept = this->sweepProgram(target, scratch, perf, ff, fitnessBudget);
+    if(cache && kept) {
+      cache->insert(key, check, perf.bitErrors);
+    }
+  }
+
+  // Restore the displaced genes, last first
+  for(unsigned i = scratch.undo.size(); i-- > 0;) {
+    this->getGene(scratch.undo[i].index).setNetworkFrame(scratch.undo[i].frame);
+  }
+
+  return kept;
+}
+
+
+
+// Materialise offspring of parent into this genome, taking on its already evaluated performance
+void genome::adoptOffspring(truthTable& target, genome const& parent,
+                            vector<geneMutation_t> const& mutations, genomePerf_t const& perf) {
+
+  // Copy the parent and apply the mutations
+  this->deriveFrom(parent, mutations);
+
+  // Incremental buffers are carried over from the parent, re-evaluating only the mutated cones
+  if(this->evaluator == GENOME_EVAL_INCREMENTAL && parent.hasCurrentGeneBuffers(target)) {
+    this->geneBuffers = parent.geneBuffers;
+    this->outputErrors = parent.outputErrors;
+    this->geneBufferStride = parent.geneBufferStride;
+    this->geneBuffersValid = true;
+    vector<uint16_t> mutated;
+    for(unsigned i = 0; i < mutations.size(); i++) {
+      mutated.push_back(mutations[i].index);
+    }
+    this->updateGeneCones(target, mutated, true);
+  }
+
+  // Refresh gene activity if the mutations could have changed it
+  if(!this->perfDataValid) {
+    evaluationScratch_t& scratch = threadScratch();
+    this->compileProgram(target, scratch);
+    this->activeFlags.assign(scratch.flags.begin(), scratch.flags.end());
+  }
+
+  // Performance data was computed when the offspring was evaluated
+  this->perfData = perf;
+  this->perfData.genomeAge = 0;
+  this->perfDataValid = true;
+}
+
+
+
+// Materialise offspring of parent into this genome
+void genome::deriveFrom(genome const& parent, vector<geneMutation_t> const& mutations) {
+
+  // Copy the parent and apply the mutations
+  this->copyFrom(parent);
+  this->applyMutations(mutations);
+
+  // Mutating inactive genes leaves activity and performance as the parent's
+  if(!parent.mutatesActiveGene(mutations)) {
+    this->perfData = parent.perfData;
+    this->perfData.genomeAge = 0;
+    this->perfDataValid = true;
+  }
+}
+
+
+
 // Parse the genome from an array of gene network frames
 void genome::parseGeneNetworkFrameArray(geneNetworkFrame_t *networkFrameArray) {
 
   // Iterate over all genes, intialising them with the network frames
-  for(unsigned i = 0; i < this->genes.size(); i++) {
-    this->genes[i] = gene(networkFrameArray[i]);
+  for(unsigned i = 0; i < this->getGeneCount(); i++) {
+    this->getGene(i).setNetworkFrame(networkFrameArray[i]);
+    this->activeFlags[i] = 0;
   }
 
-  // Performance data is now invalid
+  // Performance data and cached gene buffers are now invalid
   this->perfData.genomeAge = 0;
   this->perfDataValid = false;
+  this->invalidateGeneBuffers();
+}
+
+
+
+// Overwrite the listed genes, the rest of the genome is left as it was
+void genome::parseGeneList(vector<geneMutation_t> const& genes) {
+  this->applyMutations(genes);
+  this->activeFlags.assign(this->getGeneCount(), 0);
+
+  // Performance data and cached gene buffers are now invalid
+  this->perfData.genomeAge = 0;
+  this->perfDataValid = false;
+  this->invalidateGeneBuffers();
 }
 
 
 
 // Copy gene data from another genome
-void genome::copyFrom(genome& g) {
+void genome::copyFrom(genome const& g) {
 
-  // Iterate over genes
-  for(unsigned i = 0; i < this->genes.size(); i++) {
-    this->genes[i] = g.getGenes()[i];
-  }
+  // Bulk copy the gene arrays, storage is reused as genomes share a length
+  this->functions = g.functions;
+  this->aIndices = g.aIndices;
+  this->bIndices = g.bIndices;
+  this->activeFlags = g.activeFlags;
 
-  // Reset perf-data
+  // Reset perf-data and cached gene buffers
   this->perfData.genomeAge = 0;
   this->perfDataValid = false;
+  this->invalidateGeneBuffers();
 }
 
 
 // Output genome to file
 void genome::outputToFile(string const path) {
   ofstream fp(path);
-  for(unsigned i = 0; i < this->genes.size(); i++) {
-    if(this->genes[i].bufValid) {
+  for(unsigned i = 0; i < this->getGeneCount(); i++) {
+    if(this->activeFlags[i]) {
       fp << i << ":\t";
-      fp << this->genes[i].aIndex << " ";
-      fp << str(this->genes[i].function) << " ";
-      fp << this->genes[i].bIndex << "\n";
+      fp << this->aIndices[i] << " ";
+      fp << str(this->functions[i]) << " ";
+      fp << this->bIndices[i] << "\n";
     }
   }
 }
@@ -1,5 +1,6 @@
 // Standard headers
 #include <iostream>
+using namespace std;
 
 
 // Project headers
@@ -7,58 +8,172 @@
 #include "utils.hpp"
 
 
+// Worst case packed sizes, a gene is a header byte, an escaped gap and two input
+// distances, each a varint of at most three bytes for 16 bit indices
+#define PACKED_GENE_MAX_BYTES 10
+#define PACKED_GENOME_HEADER_MAX_BYTES 5
 
-// Constructor
-genomeTransmissionBuffer::genomeTransmissionBuffer(unsigned bufferLength) {
-  this->buffer = new geneNetworkFrame_t[bufferLength];
-  this->maxGenes = bufferLength;
-  this->currentGenes = 0;
+// Gaps between active genes up to this fit in the header byte
+#define PACKED_GAP_ESCAPE 31
+
+
+
+// Append an unsigned varint, seven bits per byte with the top bit set on all but the last
+static inline uint8_t *putVarint(uint8_t *p, uint32_t v) {
+  while(v >= 0x80) {
+    *p++ = (v & 0x7f) | 0x80;
+    v >>= 7;
+  }
+  *p++ = v;
+  return p;
 }
 
 
 
-// Get the raw data in the form of a vector of gene network frames
-geneNetworkFrame_t *genomeTransmissionBuffer::getData(void) {
+// Read an unsigned varint, false if it runs past the end of the buffer or 32 bits
+static inline bool getVarint(uint8_t const *&p, uint8_t const *end, uint32_t& v) {
+  v = 0;
+  for(unsigned shift = 0; p < end && shift < 32; shift += 7) {
+    uint8_t byte = *p++;
+    v |= (uint32_t)(byte & 0x7f) << shift;
+    if(!(byte & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+
+
+// Zigzag mapping so small negative distances stay small
+static inline uint32_t zigzag(int32_t v) {return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);}
+static inline int32_t unzigzag(uint32_t v) {return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);}
+
+
+
+// Constructor
+genomeTransmissionBuffer::genomeTransmissionBuffer(uint32_t genomeLength, uint32_t genomeCount) {
+  this->reset(genomeLength, genomeCount);
+  this->request = MPI_REQUEST_NULL;
+  this->receiving = false;
+}
+
 
-  // Return the gene data
-  return &this->buffer[0];
+
+// Empty the buffer and size it for the worst case, storage is reused where possible
+void genomeTransmissionBuffer::reset(uint32_t genomeLength, uint32_t genomeCount) {
+  this->buffer.resize(genomeCount * (PACKED_GENOME_HEADER_MAX_BYTES + genomeLength * PACKED_GENE_MAX_BYTES));
+  this->byteCount = 0;
+  this->readPosition = 0;
 }
 
 
 
-// Append a gene network frame
-void genomeTransmissionBuffer::append(geneNetworkFrame_t g) {
+// Append a genome
+void genomeTransmissionBuffer::append(genome const& g) {
+  uint32_t geneCount = g.getGeneCount();
 
-  // Check that buffer is not full
-  if(currentGenes == maxGenes) {
+  // Check that the whole genome fits
+  if(this->byteCount + PACKED_GENOME_HEADER_MAX_BYTES + geneCount * PACKED_GENE_MAX_BYTES > this->buffer.size()) {
     err("Error, genome transmit buffer overflow (append).");
   }
 
-  // Position in the buffer to start writing at
-  this->buffer[this->currentGenes] = g;
-
-  // Increment the gene count
-  this->currentGenes++;
-}
+  // Activity is only known for evaluated genomes, otherwise every gene is packed
+  vector<uint8_t> const& activeFlags = g.getActiveFlags();
+  bool evaluated = g.isEvaluated();
+  uint32_t packedCount = geneCount;
+  if(evaluated) {
+    packedCount = 0;
+    for(unsigned i = 0; i < geneCount; i++) {
+      packedCount += activeFlags[i] != 0;
+    }
+  }
 
+  // Pack the active genes straight from the gene arrays
+  vector<geneFunction_t> const& functions = g.getFunctions();
+  vector<uint16_t> const& aIndices = g.getAIndices();
+  vector<uint16_t> const& bIndices = g.getBIndices();
+  uint8_t *p = putVarint(&this->buffer[this->byteCount], packedCount);
+  int32_t previous = -1;
+  for(int32_t i = 0; i < (int32_t)geneCount; i++) {
+    if(evaluated && !activeFlags[i]) {
+      continue;
+    }
 
+    // Header byte, long gaps are escaped into a following varint
+    uint32_t gap = i - previous - 1;
+    if(gap < PACKED_GAP_ESCAPE) {
+      *p++ = functions[i] | (gap << 3);
+    } else {
+      *p++ = functions[i] | (PACKED_GAP_ESCAPE << 3);
+      p = putVarint(p, gap - PACKED_GAP_ESCAPE);
+    }
 
-// Append a gene
-void genomeTransmissionBuffer::append(gene g) {
+    // Inputs as distances back from the gene
+    p = putVarint(p, zigzag(i - aIndices[i]));
+    p = putVarint(p, zigzag(i - bIndices[i]));
+    previous = i;
+  }
 
-  // Add it to the internal vector of gene network frames
-  this->append(g.getNetworkFrame());
+  // Update the byte count
+  this->byteCount = p - &this->buffer[0];
 }
 
 
 
-// Append a genome
-void genomeTransmissionBuffer::append(genome g) {
+// Unpack the next genome over g
+void genomeTransmissionBuffer::extract(genome& g) {
+  uint8_t const *p = &this->buffer[this->readPosition];
+  uint8_t const *end = &this->buffer[0] + this->byteCount;
+
+  // Unpack the genes, decoding stops at the first field running past the end of the buffer
+  // or out of range, before any gene is overwritten
+  int64_t geneCount = g.getGeneCount();
+  uint32_t packedCount = 0;
+  if(!getVarint(p, end, packedCount) || packedCount > geneCount) {
+    err("Error, malformed genome in recieve buffer.");
+    return;
+  }
+  this->unpackedGenes.resize(packedCount);
+  int64_t previous = -1;
+  for(unsigned j = 0; j < packedCount; j++) {
+    geneMutation_t& m = this->unpackedGenes[j];
+
+    // Header byte and inputs, long gaps are escaped into a varint between them
+    if(p >= end) {
+      err("Error, malformed genome in recieve buffer.");
+      return;
+    }
+    uint8_t header = *p++;
+    uint32_t gap = header >> 3;
+    uint32_t extraGap = 0, aDistance = 0, bDistance = 0;
+    if((gap == PACKED_GAP_ESCAPE && !getVarint(p, end, extraGap)) ||
+       !getVarint(p, end, aDistance) || !getVarint(p, end, bDistance)) {
+      err("Error, malformed genome in recieve buffer.");
+      return;
+    }
 
-  // Add it to the internal vector of gene network frames
-  for(unsigned i = 0; i < g.getGeneCount(); i++) {
-    this->append(g.getGenes()[i]);
+    // Every gene but the first takes its inputs from lower indices
+    int64_t index = previous + 1 + gap + extraGap;
+    int64_t aIndex = index - unzigzag(aDistance);
+    int64_t bIndex = index - unzigzag(bDistance);
+    if(index >= geneCount || aIndex < 0 || bIndex < 0 ||
+       !((aIndex < index && bIndex < index) || (index == 0 && aIndex == 0 && bIndex == 0))) {
+      err("Error, malformed genome in recieve buffer.");
+      return;
+    }
+    m.index = index;
+    m.frame.function = (geneFunction_t)(header & 0x07);
+    m.frame.aIndex = aIndex;
+    m.frame.bIndex = bIndex;
+    previous = index;
   }
+
+  // Move past the genome
+  this->readPosition = p - &this->buffer[0];
+
+  // Overwrite the genes
+  g.parseGeneList(this->unpackedGenes);
 }
 
 
@@ -67,8 +182,8 @@ void genomeTransmissionBuffer::append(genome g) {
 void genomeTransmissionBuffer::transmit(int32_t destination, int32_t tag) {
 
   // Transmit the buffer using MPI
-  MPI_Ssend((uint8_t *)&this->buffer[0],
-           currentGenes * sizeof(geneNetworkFrame_t),
+  MPI_Ssend(&this->buffer[0],
+           this->byteCount,
            MPI_BYTE,
            destination,
            tag,
@@ -91,19 +206,15 @@ void genomeTransmissionBuffer::receive(int32_t source, int32_t tag) {
   int32_t byteCount;
   MPI_Get_count(&status, MPI_BYTE, &byteCount);
 
-  // Confirm that incoming buffer is not malformed
-  if(byteCount % sizeof(geneNetworkFrame_t) != 0) {
-    err("Error, recieve into buffer of incorrect size.");
-  } else {
-    if(this->maxGenes != (byteCount / sizeof(geneNetworkFrame_t))) {
-      err("Error, genome recieve buffer is of incorrect length.");
-    } else {
-      this->currentGenes = byteCount / sizeof(geneNetworkFrame_t);
-    }
+  // Confirm that the incoming buffer fits
+  if(byteCount > (int32_t)this->buffer.size()) {
+    err("Error, genome recieve buffer is too small.");
   }
+  this->byteCount = byteCount;
+  this->readPosition = 0;
 
   // Recieve the buffer using MPI
-  MPI_Recv((uint8_t *)&this->buffer[0],
+  MPI_Recv(&this->buffer[0],
            byteCount,
            MPI_BYTE,
            source,
@@ -113,7 +224,64 @@ void genomeTransmissionBuffer::receive(int32_t source, int32_t tag) {
 }
 
 
-// Destructor
-genomeTransmissionBuffer::~genomeTransmissionBuffer(void) {
-  delete [] this->buffer;
+
+// Check for an incoming buffer without receiving it
+bool genomeTransmissionBuffer::probe(int32_t source, int32_t tag) {
+  int flag;
+  MPI_Iprobe(source, tag, MPI_COMM_WORLD, &flag, MPI_STATUS_IGNORE);
+  return flag;
+}
+
+
+
+// Post a non-blocking transmit of the buffer
+void genomeTransmissionBuffer::postTransmit(int32_t destination, int32_t tag) {
+  MPI_Isend(&this->buffer[0],
+            this->byteCount,
+            MPI_BYTE,
+            destination,
+            tag,
+            MPI_COMM_WORLD,
+            &this->request);
+  this->receiving = false;
+}
+
+
+
+// Post a non-blocking receive, the buffer is sized for the worst case
+void genomeTransmissionBuffer::postReceive(int32_t source, int32_t tag) {
+  MPI_Irecv(&this->buffer[0],
+            this->buffer.size(),
+            MPI_BYTE,
+            source,
+            tag,
+            MPI_COMM_WORLD,
+            &this->request);
+  this->receiving = true;
+}
+
+
+
+// Check for completion of the posted operation without blocking
+bool genomeTransmissionBuffer::isComplete(void) {
+  int flag;
+  MPI_Test(&this->request, &flag, MPI_STATUS_IGNORE);
+  return flag;
+}
+
+
+
+// Block until the posted operation completes
+void genomeTransmissionBuffer::waitComplete(void) {
+  MPI_Status status;
+  MPI_Wait(&this->request, &status);
+
+  // A received buffer is as long as was sent
+  if(this->receiving) {
+    int32_t byteCount;
+    MPI_Get_count(&status, MPI_BYTE, &byteCount);
+    this->byteCount = byteCount;
+    this->readPosition = 0;
+    this->receiving = false;
+  }
 }
@@ -1,6 +1,7 @@
 // Standard headers
 #include "unistd.h"
 #include <iostream>
+#include <algorithm>
 using namespace std;
 
 
@@ -17,6 +18,13 @@ population::population(uint32_t subPopulationCount, uint32_t genomeCount, uint32
   // Initialise the algorithm
   this->algorithm = populationAlgorithm(subPopulationCount, genomeCount, genomeLength);
 
+  // No global best reduction in flight
+  this->cycleCount = 0;
+  this->globalBestFitness = UINT32_MAX;
+  this->globalBestRequest = MPI_REQUEST_NULL;
+  this->stopRequest = MPI_REQUEST_NULL;
+  this->cyclesCompleted = 0;
+
   // Population does not start initialised
   this->initialised = false;
 }
@@ -62,6 +70,10 @@ void population::initialise(truthTable& target, uint32_t(*ff)(genomePerf_t)) {
   // Sort the initial rankmap
   this->updateRankMap();
 
+  // No migrants have moved yet
+  this->migrantsSent.assign(this->subPopulations.size(), 0);
+  this->migrantsRecieved.assign(this->subPopulations.size(), 0);
+
   // We are now initialised
   this->initialised = true;
 }
@@ -105,8 +117,13 @@ void population::iterateSubPopulations(truthTable& target, uint32_t(*ff)(genomeP
   // Calculate distribution stuff
   unsigned threadCount = this->algorithm.getThreadCount();
 
+  // In (1+lambda) mode with fewer local subpopulations than threads, iterate the
+  // subpopulations one at a time and spread their offspring over the threads instead
+  bool offspringThreads = this->algorithm.getSubPopulationAlgorithm().getLambda() &&
+                          localSubPopulationIndices.size() < threadCount;
+
   // Divide up and iterate over local subpopulations
-  #pragma omp parallel for num_threads(threadCount)
+  #pragma omp parallel for num_threads(threadCount) if(!offspringThreads)
   for(unsigned i = 0; i < localSubPopulationIndices.size(); i++) {
     this->subPopulations[localSubPopulationIndices[i]].iterate(target, ff, n);
   }
@@ -114,19 +131,6 @@ void population::iterateSubPopulations(truthTable& target, uint32_t(*ff)(genomeP
 
 
 
-// Swaps two indices in the fitness map
-void population::swapRankMap(uint32_t i1, uint32_t i2) {
-
-  // Temporary store
-  auto tmp = this->rankMap[i1];
-
-  // Perform the swap
-  this->rankMap[i1] = this->rankMap[i2];
-  this->rankMap[i2] = tmp;
-}
-
-
-
 // Get key to sort rank map member by
 int64_t population::rankMapSortKey(uint32_t i) {
   return ((uint64_t)rankMap[i].fitness << 32) + rankMap[i].ptr->getDomainIndex();
@@ -134,40 +138,25 @@ int64_t population::rankMapSortKey(uint32_t i) {
 
 
 
-// Partition function for the quicksort
-int32_t population::partitionRankMap(int32_t low, int32_t high) {
-  int64_t pivot = this->rankMapSortKey(high);
-  int32_t i = low - 1;
-  for(int32_t j = low; j <= high - 1; j++) {
-    if(this->rankMapSortKey(j) <= pivot) {
-      i++;
-      this->swapRankMap(j, i);
+// Sorts the local copy of the rankmap by insertion
+// Entries keep their order between cycles, so the rankmap arrives nearly sorted
+void population::sortRankMap(void) {
+  for(unsigned i = 1; i < this->rankMap.size(); i++) {
+    auto entry = this->rankMap[i];
+    int64_t key = this->rankMapSortKey(i);
+
+    // Shift larger keys up and drop the entry into the gap
+    unsigned j = i;
+    while(j > 0 && this->rankMapSortKey(j - 1) > key) {
+      this->rankMap[j] = this->rankMap[j - 1];
+      j--;
     }
-  }
-  this->swapRankMap(i + 1, high);
-  return i + 1;
-}
-
-
-
-// Perform the quicksort
-void population::quickSortRankMap(int32_t low, int32_t high) {
-  if(low < high) {
-    int32_t pi = this->partitionRankMap(low, high);
-    this->quickSortRankMap(low, pi - 1);
-    this->quickSortRankMap(pi + 1, high);
+    this->rankMap[j] = entry;
   }
 }
 
 
 
-// Sorts the local copy of the rankmap
-void population::sortRankMap(void) {
-  quickSortRankMap(0, this->rankMap.size() - 1);
-}
-
-
-
 // Build a vector of integers respresentative of the local subpopulation
 // Format: index - fitness - index - fitness - etc etc
 unsigned *population::getRankMapTxBuffer(void) {
@@ -198,16 +187,16 @@ unsigned *population::getRankMapTxBuffer(void) {
 // Parses the rank map recieve buffer
 void population::parseRankMapRxBuffer(unsigned *rxBuffer) {
 
-  // Iterate over rankmap and fill from the recieve buffer
+  // Fitness of every subpopulation by domain index
+  vector<uint32_t> fitness(this->subPopulations.size());
   for(unsigned i = 0; i < this->rankMap.size(); i++) {
+    fitness[rxBuffer[i * 2]] = rxBuffer[(i * 2) + 1];
+  }
 
-    // Formulate rank map entry structure
-    subPopulationFitnessMapping_t rankMapEntry;
-    rankMapEntry.ptr = &this->subPopulations[rxBuffer[i * 2]];
-    rankMapEntry.fitness = rxBuffer[(i * 2) + 1];
-
-    // Add the rankmap entry to the
-    this->rankMap[i] = rankMapEntry;
+  // Update the rankmap entries in place, keeping last cycle's order so that
+  // only subpopulations whose best fitness changed need moving by the sort
+  for(unsigned i = 0; i < this->rankMap.size(); i++) {
+    this->rankMap[i].fitness = fitness[this->rankMap[i].ptr->getDomainIndex()];
   }
 }
 
@@ -308,36 +297,274 @@ void population::doSubPopulationCrossover(truthTable& target, uint32_t(*ff)(geno
 
 
 
+// Completes the migrations of every local subpopulation
+void population::completeMigrations(truthTable& target, uint32_t(*ff)(genomePerf_t)) {
+  vector<uint32_t> localSubPopulationIndices = this->getLocalSubPopulationIndices();
+  for(unsigned i = 0; i < localSubPopulationIndices.size(); i++) {
+    this->subPopulations[localSubPopulationIndices[i]].completeMigrations(target, ff);
+  }
+}
+
+
+
+// Pushes every local elite to the next subpopulation on the ring and takes
+// in whichever migrants have already arrived for the local subpopulations
+void population::exchangeElites(truthTable& target, uint32_t(*ff)(genomePerf_t)) {
+  vector<uint32_t> localSubPopulationIndices = this->getLocalSubPopulationIndices();
+  uint32_t subPopulationCount = this->subPopulations.size();
+
+  // Push elites, counting the ones sent to other processes
+  for(unsigned i = 0; i < localSubPopulationIndices.size(); i++) {
+    uint32_t d = localSubPopulationIndices[i];
+    uint32_t neighbour = (d + 1) % subPopulationCount;
+    if(this->subPopulations[d].pushElite(this->subPopulations[neighbour], target, ff)) {
+      this->migrantsSent[neighbour]++;
+    }
+  }
+
+  // Pull arrived migrants without waiting for the rest
+  for(unsigned i = 0; i < localSubPopulationIndices.size(); i++) {
+    uint32_t d = localSubPopulationIndices[i];
+    subPopulation& source = this->subPopulations[(d + subPopulationCount - 1) % subPopulationCount];
+    if(!source.isLocal()) {
+      this->migrantsRecieved[d] += this->subPopulations[d].pullMigrants(source, target, ff);
+    }
+  }
+}
+
+
+
+// Keeps a non-blocking reduction of the best fitness across processes going
+// Reductions are posted every maxStaleness cycles so every process posts the same ones
+void population::updateGlobalBest(void) {
+
+  // Pick up the last reduction if it has finished
+  if(this->globalBestRequest != MPI_REQUEST_NULL) {
+    int complete;
+    MPI_Test(&this->globalBestRequest, &complete, MPI_STATUS_IGNORE);
+    if(complete) {
+      this->globalBestFitness = this->reducedBestFitness;
+    }
+  }
+
+  // Wait for the last reduction and post the next one
+  if(this->cycleCount % this->algorithm.getMaxStaleness() == 0) {
+    if(this->globalBestRequest != MPI_REQUEST_NULL) {
+      MPI_Wait(&this->globalBestRequest, MPI_STATUS_IGNORE);
+      this->globalBestFitness = this->reducedBestFitness;
+    }
+
+    // Best of the local subpopulations
+    vector<uint32_t> localSubPopulationIndices = this->getLocalSubPopulationIndices();
+    this->localBestFitness = UINT32_MAX;
+    for(unsigned i = 0; i < localSubPopulationIndices.size(); i++) {
+      uint32_t fitness = this->subPopulations[localSubPopulationIndices[i]].getPerfData().bestGenomeFitness;
+      this->localBestFitness = min(this->localBestFitness, fitness);
+    }
+
+    // Post the reduction
+    MPI_Iallreduce(&this->localBestFitness, &this->reducedBestFitness, 1, MPI_UNSIGNED,
+                   MPI_MIN, MPI_COMM_WORLD, &this->globalBestRequest);
+  }
+}
+
+
+
+// Iterate the population through one asynchronous cycle
+void population::iterateAsynchronous(truthTable& target, uint32_t(*ff)(genomePerf_t)) {
+
+  // Iterate all local subpopulations by the apropriate number of generations per cycle
+  this->iterateSubPopulations(target, ff, this->algorithm.getGenerationsPerCycle());
+
+  // Migrate elites around the ring
+  this->exchangeElites(target, ff);
+
+  // Keep the global best fitness within bounded staleness
+  this->updateGlobalBest();
+  this->cycleCount++;
+}
+
+
+
+// Ends a run of asynchronous cycles, every migrant is recieved and the rankmap synchronised
+void population::finishAsynchronous(truthTable& target, uint32_t(*ff)(genomePerf_t)) {
+  vector<uint32_t> localSubPopulationIndices = this->getLocalSubPopulationIndices();
+  uint32_t subPopulationCount = this->subPopulations.size();
+
+  // Find how many migrants were sent to each subpopulation in total
+  vector<uint32_t> migrantsSentTotal(subPopulationCount);
+  MPI_Allreduce(&this->migrantsSent[0], &migrantsSentTotal[0], subPopulationCount,
+                MPI_UNSIGNED, MPI_SUM, MPI_COMM_WORLD);
+
+  // Recieve the migrants still in flight
+  for(unsigned i = 0; i < localSubPopulationIndices.size(); i++) {
+    uint32_t d = localSubPopulationIndices[i];
+    subPopulation& source = this->subPopulations[(d + subPopulationCount - 1) % subPopulationCount];
+    for(; this->migrantsRecieved[d] < migrantsSentTotal[d]; this->migrantsRecieved[d]++) {
+      this->subPopulations[d].receiveMigrant(source, target, ff);
+    }
+  }
+
+  // Finish the elite transmits
+  for(unsigned i = 0; i < localSubPopulationIndices.size(); i++) {
+    this->subPopulations[localSubPopulationIndices[i]].completeEliteTransmit();
+  }
+
+  // Finish the global best reduction
+  if(this->globalBestRequest != MPI_REQUEST_NULL) {
+    MPI_Wait(&this->globalBestRequest, MPI_STATUS_IGNORE);
+    this->globalBestFitness = this->reducedBestFitness;
+  }
+
+  // Synchonise the global rankmap across all processes
+  this->updateRankMap();
+  this->globalBestFitness = this->rankMap[0].fitness;
+}
+
+
+
 // Iterate the population through one cycle
 void population::iterate(truthTable& target, uint32_t(*ff)(genomePerf_t)) {
 
   // Make sure the population is initialised
   this->assertInitialised("Error, attempted to iterate uninitialised population.");
 
+  // Asynchronous cycles skip crossover and the rankmap synchronisation
+  if(this->algorithm.getAsynchronous()) {
+    this->iterateAsynchronous(target, ff);
+    return;
+  }
+
   // Do subpopulation crossover
   this->doSubPopulationCrossover(target, ff);
 
   // Iterate all local subpopulations by the apropriate number of generations per cycle
   this->iterateSubPopulations(target, ff, this->algorithm.getGenerationsPerCycle());
 
+  // Crossover migrations between processes were overlapped with the iteration
+  this->completeMigrations(target, ff);
+
   // Synchonise the global rankmap across all processes
   this->updateRankMap();
+  this->globalBestFitness = this->rankMap[0].fitness;
+}
+
+
+
+// Posts the stop criteria reduction for the local elites
+void population::postStopReduction(truthTable& target) {
+
+  // Reduce the local elites
+  vector<uint32_t> localSubPopulationIndices = this->getLocalSubPopulationIndices();
+  std::fill(this->stopLocal, this->stopLocal + STOP_REDUCTION_LENGTH, UINT32_MAX);
+  for(unsigned i = 0; i < localSubPopulationIndices.size(); i++) {
+    subPopulation& subPop = this->subPopulations[localSubPopulationIndices[i]];
+    genomePerf_t perf = subPop.getBestGenomePerf(target);
+    this->stopLocal[STOP_BIT_ERRORS] = min(this->stopLocal[STOP_BIT_ERRORS], perf.bitErrors);
+    if(!perf.bitErrors) {
+      this->stopLocal[STOP_COST] = min(this->stopLocal[STOP_COST], this->algorithm.stopCostOf(perf));
+    }
+    this->stopLocal[STOP_FITNESS] = min(this->stopLocal[STOP_FITNESS], subPop.getPerfData().bestGenomeFitness);
+  }
+
+  // Out of time on this process
+  if(this->algorithm.getStopTime() > 0 && MPI_Wtime() - this->startTime >= this->algorithm.getStopTime()) {
+    this->stopLocal[STOP_TIME_LEFT] = 0;
+  }
+
+  // Post the reduction
+  MPI_Iallreduce(this->stopLocal, this->stopReduced, STOP_REDUCTION_LENGTH, MPI_UNSIGNED,
+                 MPI_MIN, MPI_COMM_WORLD, &this->stopRequest);
+}
+
+
+
+// Checks the stop criteria against the reduction posted last cycle and posts the next one
+// Every process sees the same reduction, so they all stop on the same cycle
+bool population::stopCriteriaMet(truthTable& target) {
+
+  // First cycle has nothing to check
+  if(this->stopRequest == MPI_REQUEST_NULL) {
+    this->postStopReduction(target);
+    return false;
+  }
+
+  // Has had a whole cycle to complete
+  MPI_Wait(&this->stopRequest, MPI_STATUS_IGNORE);
+
+  // Track stagnation of the best fitness
+  if(this->stopReduced[STOP_FITNESS] < this->stopBestFitness) {
+    this->stopBestFitness = this->stopReduced[STOP_FITNESS];
+    this->stagnantCycles = 0;
+  } else {
+    this->stagnantCycles++;
+  }
+
+  // Check the criteria
+  bool stop = false;
+  if(this->algorithm.getStopOnZeroErrors() && this->stopReduced[STOP_BIT_ERRORS] == 0) stop = true;
+  if(this->algorithm.getStopCost() && this->stopReduced[STOP_COST] <= this->algorithm.getStopCost()) stop = true;
+  if(this->stopReduced[STOP_TIME_LEFT] == 0) stop = true;
+  if(this->algorithm.getStopStagnation() && this->stagnantCycles >= this->algorithm.getStopStagnation()) stop = true;
+
+  // Keep the reductions going
+  if(!stop) {
+    this->postStopReduction(target);
+  }
+  return stop;
 }
 
 
 
 // Iterate the population through n cycles
 void population::iterate(truthTable& target, uint32_t(*ff)(genomePerf_t), uint32_t n) {
+  bool checkStop = this->algorithm.hasStopCriteria();
+  this->startTime = MPI_Wtime();
+  this->stopBestFitness = UINT32_MAX;
+  this->stagnantCycles = 0;
 
-  // Iterate the population through n cycles
-  for(unsigned i = 0; i < n; i++) {
+  // Iterate the population through n cycles, or until the stop criteria are met
+  for(this->cyclesCompleted = 0; this->cyclesCompleted < n;) {
     this->iterate(target, ff);
+    this->cyclesCompleted++;
     // this->rankMap[0].ptr->printRankMap(target);
+    if(checkStop && this->stopCriteriaMet(target)) {
+      break;
+    }
+  }
+
+  // Drop the reduction still in flight
+  if(this->stopRequest != MPI_REQUEST_NULL) {
+    MPI_Wait(&this->stopRequest, MPI_STATUS_IGNORE);
+  }
+
+  // Bring asynchronous processes back into step
+  if(this->algorithm.getAsynchronous()) {
+    this->finishAsynchronous(target, ff);
   }
 }
 
 
 
+// Sums fitness cache statistics over the local subpopulations of every process
+void population::getFitnessCacheStats(uint64_t& lookupCount, uint64_t& hitCount) {
+  vector<uint32_t> localSubPopulationIndices = this->getLocalSubPopulationIndices();
+  uint64_t local[2] = {0, 0};
+  for(unsigned i = 0; i < localSubPopulationIndices.size(); i++) {
+    fitnessCache const& cache = this->subPopulations[localSubPopulationIndices[i]].getFitnessCache();
+    local[0] += cache.getLookupCount();
+    local[1] += cache.getHitCount();
+  }
+
+  // Reduce over every process
+  uint64_t total[2];
+  MPI_Allreduce(local, total, 2, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+  lookupCount = total[0];
+  hitCount = total[1];
+}
+
+
+
 // Print the rank map on each of the ranks indicated in "ranks"
 void population::printRankMap(void) {
 
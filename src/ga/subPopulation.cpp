@@ -1,5 +1,6 @@
 // Standard headers
 #include <iostream>
+#include <omp.h>
 using namespace std;
 
 
@@ -9,6 +10,11 @@ using namespace std;
 
 
 
+// Generations between checks on migrations in flight
+#define MIGRATION_PROGRESS_INTERVAL 64
+
+
+
 // Population domain decomposition function
 int32_t domainDecomposition(uint32_t indexWithinDomain) {
 
@@ -36,6 +42,12 @@ subPopulation::subPopulation(uint32_t populationSize, uint32_t genomeSize) {
   this->commWorldAddress = 0;
   this->local = false;
 
+  // No elite in flight
+  this->eliteInFlight = false;
+
+  // Sampling starts from the first lane
+  this->sampleRotation = 0;
+
   // This subpopulation is not initialised
   this->initialised = false;
 }
@@ -56,6 +68,12 @@ subPopulation::subPopulation(subPopulationAlgorithm algorithm) {
   this->commWorldAddress = 0;
   this->local = false;
 
+  // No elite in flight
+  this->eliteInFlight = false;
+
+  // Sampling starts from the first lane
+  this->sampleRotation = 0;
+
   // This subpopulation is not initialised
   this->initialised = false;
 }
@@ -71,6 +89,10 @@ void subPopulation::initialise(truthTable& target, uint32_t(*ff)(genomePerf_t),
   // Is this subpopulation local or not?
   if(this->commWorldAddress == myRank()) {
 
+    // Start with an empty fitness cache, as it only holds results for this target
+    this->cache.setCapacity(this->algorithm.getFitnessCacheSize());
+    this->cache.clear();
+
     // Initialise random genomes to the genome vector
     for(unsigned i = 0; i < algorithm.getGenomeCount(); i++) {
       this->genomes.push_back(genome(algorithm.getGenomeLength(), algorithm));
@@ -118,19 +140,6 @@ bool subPopulation::isLocal(void) {
 
 
 
-// Swaps two indices in the fitness map
-void subPopulation::swapRankMap(uint32_t i1, uint32_t i2) {
-
-  // Temporary store for a tuple
-  auto tmp = this->rankMap[i1];
-
-  // Perform the swap
-  this->rankMap[i1] = this->rankMap[i2];
-  this->rankMap[i2] = tmp;
-}
-
-
-
 // Get key to sort rank map with
 int64_t subPopulation::rankMapSortKey(uint32_t i) {
   return ((uint64_t)rankMap[i].fitness << 32) + rankMap[i].index;
@@ -138,36 +147,21 @@ int64_t subPopulation::rankMapSortKey(uint32_t i) {
 
 
 
-// Partition function for the quicksort
-int32_t subPopulation::partitionRankMap(int32_t low, int32_t high) {
-  int64_t pivot = this->rankMapSortKey(high);
-  int32_t i = low - 1;
-  for(int32_t j = low; j <= high - 1; j++) {
-    if((int64_t)this->rankMapSortKey(j) <= pivot) {
-      i++;
-      this->swapRankMap(i, j);
+// Sorts the rankmap by insertion, only genomes replaced since the last generation
+// can be out of place, so this is linear in the common case
+void subPopulation::sortRankMap(void) {
+  for(unsigned i = 1; i < this->rankMap.size(); i++) {
+    auto entry = this->rankMap[i];
+    int64_t key = this->rankMapSortKey(i);
+
+    // Shift larger keys up and drop the entry into the gap
+    unsigned j = i;
+    while(j > 0 && this->rankMapSortKey(j - 1) > key) {
+      this->rankMap[j] = this->rankMap[j - 1];
+      j--;
     }
+    this->rankMap[j] = entry;
   }
-  this->swapRankMap(i + 1, high);
-  return i + 1;
-}
-
-
-
-// Quicksort, somehow
-void subPopulation::quickSortRankMap(int32_t low, int32_t high) {
-  if(low < high) {
-    int32_t pi = this->partitionRankMap(low, high);
-    this->quickSortRankMap(low, pi - 1);
-    this->quickSortRankMap(pi + 1, high);
-  }
-}
-
-
-
-// Sorts the things
-void subPopulation::sortRankMap(void) {
-  this->quickSortRankMap(0, this->rankMap.size() - 1);
 }
 
 
@@ -175,6 +169,15 @@ void subPopulation::sortRankMap(void) {
 // Updates the rankmap
 void subPopulation::updateRankMap(truthTable& target, uint32_t(*ff)(genomePerf_t)) {
 
+  // Genomes lacking performance data are evaluated together a table block at a time
+  vector<genome *> pending;
+  for(unsigned i = 0; i < this->rankMap.size(); i++) {
+    if(!this->rankMap[i].ptr->isEvaluated()) {
+      pending.push_back(this->rankMap[i].ptr);
+    }
+  }
+  genome::evaluateBatch(target, pending, NULL, 0, NULL, &this->cache);
+
   // Update the rankmap fitness values
   for(unsigned i = 0; i < this->rankMap.size(); i++) {
     this->rankMap[i].fitness = ff(this->rankMap[i].ptr->getPerfData(target));
@@ -192,6 +195,60 @@ void subPopulation::iterate(truthTable& target, uint32_t(*ff)(genomePerf_t)) {
   // Assert that the population is initialised
   this->assertInitialised("Error, attempted to iterate uninitialised subpopulation.");
 
+  // (1+lambda) mode replaces steady state selection
+  if(this->algorithm.getLambda()) {
+    this->iterateOnePlusLambda(target, ff);
+  } else {
+    this->iterateSteadyState(target, ff);
+  }
+
+  // Increment genome ages
+  for(unsigned i = 0; i < this->rankMap.size(); i++) {
+    this->rankMap[i].ptr->incrementAge();
+  }
+
+  // Update the rankmap
+  this->updateRankMap(target, ff);
+}
+
+
+
+// Picks this generation's sample, every stride'th lane of the table from an offset that moves
+// on each generation, so every lane is screened on in turn. Returns false if sampling is off or
+// the sample would cover so much of the table that screening can't pay for itself
+bool subPopulation::updateSampleScreen(truthTable& target) {
+  uint32_t sampleLanes = (this->algorithm.getSampleBitmaps() + BITVECTOR_LANE_WORDS - 1) / BITVECTOR_LANE_WORDS;
+  uint32_t laneCount = target.getLaneBitmapCount() / BITVECTOR_LANE_WORDS;
+  if(sampleLanes == 0 || 2 * sampleLanes > laneCount) {
+    return false;
+  }
+
+  // Spread the sampled lanes evenly over the table
+  uint32_t stride = laneCount / sampleLanes;
+  uint32_t offset = this->sampleRotation++ % stride;
+  this->screen.bitmaps.resize(sampleLanes);
+  for(unsigned i = 0; i < sampleLanes; i++) {
+    this->screen.bitmaps[i] = (i * stride + offset) * BITVECTOR_LANE_WORDS;
+  }
+  this->screen.scale = (double)laneCount / sampleLanes;
+  return true;
+}
+
+
+
+// Steady state selection, each selection replaces a low ranked genome with a mutant of a high ranked one
+// The mutant is held as its parent plus a list of mutations and only copied into place once kept
+// Under early exit or screening it is only kept if it may rank above the worst genome kept so
+// far this generation, each parent being measured on the sample once per generation however
+// many offspring it has
+void subPopulation::iterateSteadyState(truthTable& target, uint32_t(*ff)(genomePerf_t)) {
+  bool sampling = this->updateSampleScreen(target);
+  if(sampling) {
+    this->sampleErrors.assign(this->genomes.size(), UINT32_MAX);
+  }
+  bool budgeted = this->algorithm.getEarlyExit() || sampling;
+  uint32_t worstFitness = this->rankMap.back().fitness;
+
   // For every selection
   for(unsigned i = 0; i < this->algorithm.getSelectCount(); i++) {
 
@@ -205,18 +262,113 @@ void subPopulation::iterate(truthTable& target, uint32_t(*ff)(genomePerf_t)) {
 
     // Select a genome, and mutate
     if (fitIdx != unfitIdx) {
-      *unfitGenome = *fitGenome;
-      unfitGenome->mutate(this->algorithm);
+      genomePerf_t perf;
+      fitGenome->drawMutations(this->algorithm, this->mutations);
+
+      // Parent figures the child is screened against, only needed if the child must be swept
+      if(sampling && fitGenome->mutatesActiveGene(this->mutations)) {
+        uint32_t& parentSampleErrors = this->sampleErrors[this->rankMap[fitIdx].index];
+        if(parentSampleErrors == UINT32_MAX) {
+          parentSampleErrors = fitGenome->sampleBitErrors(target, this->screen.bitmaps);
+        }
+        this->screen.parentBitErrors = fitGenome->getPerfData(target).bitErrors;
+        this->screen.parentSampleErrors = parentSampleErrors;
+      }
+
+      // Without a budget every child is kept
+      uint32_t budget = budgeted ? worstFitness : UINT32_MAX;
+      if(fitGenome->evaluateOffspring(target, this->mutations, ff, budget, perf,
+                                      sampling ? &this->screen : NULL, &this->cache)) {
+        unfitGenome->adoptOffspring(target, *fitGenome, this->mutations, perf);
+        if(sampling) {
+          this->sampleErrors[this->rankMap[unfitIdx].index] = UINT32_MAX;
+        }
+
+        // The rank map isn't sorted until the generation ends, but the fitness of the
+        // replaced genome and so the worst fitness kept are brought up to date
+        uint32_t replacedFitness = this->rankMap[unfitIdx].fitness;
+        this->rankMap[unfitIdx].fitness = ff(perf);
+        if(this->rankMap[unfitIdx].fitness >= worstFitness) {
+          worstFitness = this->rankMap[unfitIdx].fitness;
+        } else if(replacedFitness == worstFitness) {
+          worstFitness = 0;
+          for(unsigned j = 0; j < this->rankMap.size(); j++) {
+            worstFitness = max(worstFitness, this->rankMap[j].fitness);
+          }
+        }
+      }
     }
   }
+}
 
-  // Increment genome ages
-  for(unsigned i = 0; i < this->rankMap.size(); i++) {
-    this->rankMap[i].ptr->incrementAge();
+
+
+// One (1+lambda) generation, lambda mutants of the elite genome are evaluated concurrently
+// The best mutant replaces the worst genome if it is no less fit than the elite, as genome
+// age is part of fitness, equally fit mutants win and the elite drifts neutrally
+// Mutants screened out on the sample can't win, so only exact fitnesses reach the rank map,
+// and the elite is measured afresh on each generation's sample as it rotates
+void subPopulation::iterateOnePlusLambda(truthTable& target, uint32_t(*ff)(genomePerf_t)) {
+  genome* elite = this->rankMap[0].ptr;
+  uint32_t eliteFitness = this->rankMap[0].fitness;
+  uint32_t lambda = this->algorithm.getLambda();
+  bool earlyExit = this->algorithm.getEarlyExit();
+
+  // Offspring storage is created on first use and reused afterwards
+  while(this->offspring.size() < lambda) {
+    this->offspring.push_back(*elite);
   }
+  this->offspringMutations.resize(lambda);
+  this->offspringFitness.resize(lambda);
 
-  // Update the rankmap
-  this->updateRankMap(target, ff);
+  // Draw mutations up front so results don't depend on thread scheduling
+  for(unsigned i = 0; i < lambda; i++) {
+    elite->drawMutations(this->algorithm, this->offspringMutations[i]);
+  }
+
+  // Reference figures the mutants are screened against, only needed if a mutant must be swept
+  bool sampling = this->updateSampleScreen(target);
+  if(sampling) {
+    bool swept = false;
+    for(unsigned i = 0; i < lambda && !swept; i++) {
+      swept = elite->mutatesActiveGene(this->offspringMutations[i]);
+    }
+    if(swept) {
+      this->screen.parentBitErrors = elite->getPerfData(target).bitErrors;
+      this->screen.parentSampleErrors = elite->sampleBitErrors(target, this->screen.bitmaps);
+    }
+  }
+
+  // Evaluate offspring concurrently, this collapses to a single thread if the
+  // subpopulations themselves are already being iterated in parallel
+  // Each thread sweeps its share of the offspring as one batch, a table block at a time
+  #pragma omp parallel num_threads(this->algorithm.getThreadCount())
+  {
+    vector<genome *> batch;
+    for(unsigned i = omp_get_thread_num(); i < lambda; i += omp_get_num_threads()) {
+      this->offspring[i].deriveFrom(*elite, this->offspringMutations[i]);
+      batch.push_back(&this->offspring[i]);
+    }
+    genome::evaluateBatch(target, batch, (earlyExit || sampling) ? ff : NULL, eliteFitness,
+                          sampling ? &this->screen : NULL, &this->cache);
+    for(unsigned i = omp_get_thread_num(); i < lambda; i += omp_get_num_threads()) {
+      genome& child = this->offspring[i];
+      this->offspringFitness[i] = child.isEvaluated() ? ff(child.getPerfData(target)) : UINT32_MAX;
+    }
+  }
+
+  // Best offspring, first wins ties
+  uint32_t best = 0;
+  for(unsigned i = 1; i < lambda; i++) {
+    if(this->offspringFitness[i] < this->offspringFitness[best]) {
+      best = i;
+    }
+  }
+
+  // Replace the worst genome
+  if(this->offspringFitness[best] <= eliteFitness) {
+    swap(*this->rankMap.back().ptr, this->offspring[best]);
+  }
 }
 
 
@@ -227,6 +379,11 @@ void subPopulation::iterate(truthTable& target, uint32_t(*ff)(genomePerf_t), uin
   // Iterate the population n times
   for(unsigned i = 0; i < n; i++) {
     this->iterate(target, ff);
+
+    // Keep migrations moving, MPI is only called from the main thread
+    if((i % MIGRATION_PROGRESS_INTERVAL == 0) && (omp_get_thread_num() == 0)) {
+      progressCommunication();
+    }
   }
 }
 
@@ -279,53 +436,159 @@ void subPopulation::copyGenomes(vector<uint32_t>& genomeIndices, subPopulation&
 // Parse buffer
 void subPopulation::parseGenomeBuffer(genomeTransmissionBuffer& buffer, vector<uint32_t>& genomeIndices) {
 
-  // Get the raw buffer
-  geneNetworkFrame_t *geneData = buffer.getData();
-  geneNetworkFrame_t *geneNetworkFramePtr;
-
-  // Parse the genomes one by one
+  // Unpack the genomes one by one
   for(unsigned i = 0; i < genomeIndices.size(); i++) {
-    geneNetworkFramePtr = &geneData[i * this->algorithm.getGenomeLength()];
-    this->genomes[genomeIndices[i]].parseGeneNetworkFrameArray(geneNetworkFramePtr);
+    buffer.extract(this->genomes[genomeIndices[i]]);
   }
 }
 
 
 
-// Transmits genomes
+// Get a free migration slot with a buffer for the given number of genomes
+genomeMigration_t& subPopulation::allocateMigration(uint32_t genomeCount) {
+
+  // Reuse a completed migration if there is one
+  unsigned i = 0;
+  while(i < this->migrations.size() && this->migrations[i].active) {
+    i++;
+  }
+  if(i == this->migrations.size()) {
+    this->migrations.push_back(genomeMigration_t());
+  }
+
+  // Prepare it
+  genomeMigration_t& migration = this->migrations[i];
+  migration.buffer.reset(this->algorithm.getGenomeLength(), genomeCount);
+  migration.active = true;
+  return migration;
+}
+
+
+
+// Transmits genomes, the transmit completes at the end of the cycle
 void subPopulation::exportGenomes(vector<uint32_t>& genomeIndices, subPopulation& target, uint32_t tag) {
 
   // Make sure we are local
   this->assertLocal("Error, attempt to export genomes from nonlocal subpopulation.");
 
-  // Create a transmit buffer
-  genomeTransmissionBuffer txBuffer(genomeIndices.size() * this->algorithm.getGenomeLength());
+  // Get a transmit buffer
+  genomeMigration_t& migration = this->allocateMigration(genomeIndices.size());
+  migration.import = false;
 
   // Add genomes to export to the buffer
   for(unsigned i = 0; i < genomeIndices.size(); i++) {
-    txBuffer.append(this->genomes[genomeIndices[i]]);
+    migration.buffer.append(this->genomes[genomeIndices[i]]);
   }
 
-  // Transmit the contents of the buffer
-  txBuffer.transmit(target.getProcessRank(), this->getDomainIndex());
+  // Post the transmit
+  migration.buffer.postTransmit(target.getProcessRank(), tag);
 }
 
 
 
-// Recieves genomes
+// Recieves genomes, they replace the genomes at genomeIndices when the migration completes
 void subPopulation::importGenomes(vector<uint32_t>& genomeIndices, subPopulation& source, uint32_t tag) {
 
   // Make sure we are local
   this->assertLocal("Error, attempt to import genomes to nonlocal subpopulation.");
 
-  // Create a recieve buffer of apropriate size
-  genomeTransmissionBuffer rxBuffer(source.getAlgorithm().getGenomeLength() * genomeIndices.size());
+  // Get a recieve buffer of apropriate size
+  genomeMigration_t& migration = this->allocateMigration(genomeIndices.size());
+  migration.import = true;
+  migration.genomeIndices = genomeIndices;
+
+  // Post the recieve operation
+  migration.buffer.postReceive(source.getProcessRank(), tag);
+}
+
 
-  // Perform the recieve operation
-  rxBuffer.receive(source.getProcessRank(), source.getDomainIndex());
 
-  // Parse the genomes from the input buffer
-  this->parseGenomeBuffer(rxBuffer, genomeIndices);
+// Completes all migrations in flight, parsing imported genomes into place
+void subPopulation::completeMigrations(truthTable& target, uint32_t(*ff)(genomePerf_t)) {
+  bool imported = false;
+
+  // Wait for each migration in turn
+  for(unsigned i = 0; i < this->migrations.size(); i++) {
+    genomeMigration_t& migration = this->migrations[i];
+    if(migration.active) {
+      migration.buffer.waitComplete();
+      if(migration.import) {
+        this->parseGenomeBuffer(migration.buffer, migration.genomeIndices);
+        imported = true;
+      }
+      migration.active = false;
+    }
+  }
+
+  // Imported genomes need ranking
+  if(imported) {
+    this->updateRankMap(target, ff);
+  }
+}
+
+
+
+// Pushes the elite genome to a neighbouring subpopulation, where it replaces the worst genome
+// A remote push is skipped while the previous one is still in flight, returns true if one was posted
+bool subPopulation::pushElite(subPopulation& neighbour, truthTable& target, uint32_t(*ff)(genomePerf_t)) {
+  genome& elite = *this->rankMap[0].ptr;
+
+  // Local neighbours take a copy straight away
+  if(neighbour.isLocal()) {
+    if(&neighbour != this) {
+      neighbour.rankMap.back().ptr->copyFrom(elite);
+      neighbour.updateRankMap(target, ff);
+    }
+    return false;
+  }
+
+  // Only one elite in flight at a time
+  if(this->eliteInFlight && !this->eliteBuffer.isComplete()) {
+    return false;
+  }
+
+  // Post the transmit
+  this->eliteBuffer.reset(this->algorithm.getGenomeLength());
+  this->eliteBuffer.append(elite);
+  this->eliteBuffer.postTransmit(neighbour.getProcessRank(), ELITE_MIGRATION_TAG_BASE + neighbour.getDomainIndex());
+  this->eliteInFlight = true;
+  return true;
+}
+
+
+
+// Recieves every migrant which has already arrived from a remote source, returns the count
+uint32_t subPopulation::pullMigrants(subPopulation& source, truthTable& target, uint32_t(*ff)(genomePerf_t)) {
+  uint32_t count = 0;
+  while(genomeTransmissionBuffer::probe(source.getProcessRank(), ELITE_MIGRATION_TAG_BASE + this->getDomainIndex())) {
+    this->receiveMigrant(source, target, ff);
+    count++;
+  }
+  return count;
+}
+
+
+
+// Recieves one migrant from a remote source, waiting for it if need be
+void subPopulation::receiveMigrant(subPopulation& source, truthTable& target, uint32_t(*ff)(genomePerf_t)) {
+
+  // Recieve the genome
+  this->migrantBuffer.reset(this->algorithm.getGenomeLength());
+  this->migrantBuffer.receive(source.getProcessRank(), ELITE_MIGRATION_TAG_BASE + this->getDomainIndex());
+
+  // Replace the worst genome
+  this->migrantBuffer.extract(*this->rankMap.back().ptr);
+  this->updateRankMap(target, ff);
+}
+
+
+
+// Waits for the last elite transmit to complete
+void subPopulation::completeEliteTransmit(void) {
+  if(this->eliteInFlight) {
+    this->eliteBuffer.waitComplete();
+    this->eliteInFlight = false;
+  }
 }
 
 
@@ -378,7 +641,7 @@ void subPopulation::crossover(subPopulation& pop1, subPopulation& pop2, vector<u
 
 
 // Get a copy of a specific genome
-vector<genome> subPopulation::getGenomes(void) {
+vector<genome>& subPopulation::getGenomes(void) {
 
   // Check that this is a local subpopulation
   assertInitialised("Error, attempt to retrieve genomes from uninitialised subpopulation.");
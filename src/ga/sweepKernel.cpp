@@ -0,0 +1,245 @@
+// Standard headers
+#include <iostream>
+#include <immintrin.h>
+using namespace std;
+
+
+// Project headers
+#include "sweepKernel.hpp"
+#include "utils.hpp"
+
+
+
+// Vector types for wide lanes, only ever operated on inside target specific functions
+typedef uint64_t u64x4_t __attribute__((vector_size(32)));
+typedef uint64_t u64x8_t __attribute__((vector_size(64)));
+
+
+// Gene function mask table
+static const uint64_t ONES = ~((uint64_t)0);
+const geneFunctionMasks_t geneFunctionMasks[8] = {
+  {0,    0,    0,    ONES, 0},      // GENE_FN_NOP
+  {0,    0,    0,    ONES, ONES},   // GENE_FN_NOT
+  {ONES, 0,    0,    0,    0},      // GENE_FN_AND
+  {ONES, 0,    0,    0,    ONES},   // GENE_FN_NAND
+  {0,    ONES, 0,    0,    0},      // GENE_FN_OR
+  {0,    ONES, 0,    0,    ONES},   // GENE_FN_NOR
+  {0,    0,    ONES, 0,    0},      // GENE_FN_XOR
+  {0,    0,    ONES, 0,    ONES}    // GENE_FN_XNOR
+};
+
+
+// Low six input columns of tables in counting order, one widest lane of each
+#define COUNTER_LANE(x) {x, x, x, x, x, x, x, x}
+static const uint64_t counterLanes[6][8] = {
+  COUNTER_LANE(0x5555555555555555ULL), COUNTER_LANE(0x3333333333333333ULL),
+  COUNTER_LANE(0x0f0f0f0f0f0f0f0fULL), COUNTER_LANE(0x00ff00ff00ff00ffULL),
+  COUNTER_LANE(0x0000ffff0000ffffULL), COUNTER_LANE(0x00000000ffffffffULL)};
+
+
+//========[LANE WIDTH]===========================================================================//
+
+// Widest lane supported by the running CPU
+laneWidth_t supportedLaneWidth(void) {
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vpopcntdq")) {
+    return LANE_WIDTH_512;
+  }
+  if(__builtin_cpu_supports("avx2")) {
+    return LANE_WIDTH_256;
+  }
+  return LANE_WIDTH_64;
+}
+
+
+
+// Currently selected lane width, the widest supported until set
+// The first call initialises it, which C++11 makes safe from inside parallel regions
+static laneWidth_t& selectedLaneWidth(void) {
+  static laneWidth_t laneWidth = supportedLaneWidth();
+  return laneWidth;
+}
+
+
+
+// Force a lane width, falls back to the widest supported if the CPU can't do it
+// Only to be called outside parallel regions, as sweeps read the width unsynchronised
+void setLaneWidth(laneWidth_t const w) {
+  laneWidth_t supported = supportedLaneWidth();
+  if(w == LANE_WIDTH_AUTO) {
+    selectedLaneWidth() = supported;
+  } else if(w > supported) {
+    cout << "Warning, requested lane width not supported by this CPU, using " << supported * 64 << " bits.\n";
+    selectedLaneWidth() = supported;
+  } else {
+    selectedLaneWidth() = w;
+  }
+}
+
+
+
+// Get the lane width in use
+laneWidth_t getLaneWidth(void) {
+  return selectedLaneWidth();
+}
+
+
+
+//========[KERNELS]==============================================================================//
+
+// Evaluates the compiled program over one lane of W words starting at bitmap k
+// Plain vector code, takes on the instruction set of whichever kernel inlines it
+template<typename V, unsigned W>
+static inline __attribute__((always_inline)) void sweepLane(sweepJob_t const& job, uint32_t k) {
+  uint64_t *scratch = job.scratch;
+
+  // Load inputs into their slots, inputs in counting order are made from the bitmap index
+  // The low six repeat within every bitmap, the rest are a bit of the index spread over a word
+  if(job.counterInputs) {
+    uint64_t words[W];
+    for(unsigned w = 0; w < W; w++) {
+      words[w] = job.firstBitmap + k + w;
+    }
+    V index, v;
+    __builtin_memcpy(&index, words, sizeof(V));
+    for(unsigned i = 0; i < job.inputCount; i++) {
+      if(i < 6) {
+        __builtin_memcpy(&v, counterLanes[i], sizeof(V));
+      } else {
+        v = -((index >> (i - 6)) & 1);
+      }
+      __builtin_memcpy(&scratch[i * W], &v, sizeof(V));
+    }
+  } else {
+    for(unsigned i = 0; i < job.inputCount; i++) {
+      __builtin_memcpy(&scratch[i * W], &job.inputs[i][k], sizeof(V));
+    }
+  }
+
+  // Evaluate active genes in order
+  for(unsigned j = 0; j < job.programLength; j++) {
+    geneInstruction_t const& inst = job.program[j];
+    geneFunctionMasks_t const& m = geneFunctionMasks[inst.function & 0x07];
+    V a, b, v;
+    __builtin_memcpy(&a, &scratch[inst.aIndex * W], sizeof(V));
+    __builtin_memcpy(&b, &scratch[inst.bIndex * W], sizeof(V));
+    v = (((a & b) & m.andMask) |
+         ((a | b) & m.orMask) |
+         ((a ^ b) & m.xorMask) |
+         (a & m.nopMask)) ^ m.invMask;
+    __builtin_memcpy(&scratch[inst.outIndex * W], &v, sizeof(V));
+  }
+}
+
+
+
+// Scalar kernel body, popcount instruction depends on the caller
+static inline __attribute__((always_inline)) uint32_t sweepRangeScalar(sweepJob_t const& job, uint32_t first, uint32_t last) {
+  uint32_t bitErrors = 0;
+  for(uint32_t k = first; k < last; k++) {
+    sweepLane<uint64_t, 1>(job, k);
+    for(unsigned j = 0; j < job.outputCount; j++) {
+      uint64_t difference = (job.scratch[job.outputSlots[j]] ^ job.outputs[j][k]) & job.cares[j][k];
+      bitErrors += __builtin_popcountll(difference);
+    }
+  }
+  return bitErrors;
+}
+
+
+
+// Portable 64 bit kernel
+static uint32_t sweepRange64(sweepJob_t const& job, uint32_t first, uint32_t last) {
+  return sweepRangeScalar(job, first, last);
+}
+
+
+
+// 64 bit kernel with hardware popcount
+__attribute__((target("popcnt")))
+static uint32_t sweepRange64Popcnt(sweepJob_t const& job, uint32_t first, uint32_t last) {
+  return sweepRangeScalar(job, first, last);
+}
+
+
+
+// Per 64 bit element popcount of a 256 bit vector (nibble lookup, sum of absolute differences)
+__attribute__((target("avx2")))
+static inline __m256i popcount256(__m256i v) {
+  const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                          0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low = _mm256_set1_epi8(0x0f);
+  __m256i lo = _mm256_and_si256(v, low);
+  __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low);
+  __m256i counts = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo), _mm256_shuffle_epi8(lookup, hi));
+  return _mm256_sad_epu8(counts, _mm256_setzero_si256());
+}
+
+
+
+// 256 bit AVX2 kernel
+__attribute__((target("avx2")))
+static uint32_t sweepRange256(sweepJob_t const& job, uint32_t first, uint32_t last) {
+  __m256i acc = _mm256_setzero_si256();
+  for(uint32_t k = first; k < last; k += 4) {
+    sweepLane<u64x4_t, 4>(job, k);
+    for(unsigned j = 0; j < job.outputCount; j++) {
+      __m256i mask = _mm256_loadu_si256((const __m256i *)&job.cares[j][k]);
+      __m256i buf = _mm256_loadu_si256((const __m256i *)&job.scratch[job.outputSlots[j] * 4]);
+      __m256i target = _mm256_loadu_si256((const __m256i *)&job.outputs[j][k]);
+      __m256i difference = _mm256_and_si256(_mm256_xor_si256(buf, target), mask);
+      acc = _mm256_add_epi64(acc, popcount256(difference));
+    }
+  }
+
+  // Horizontal sum
+  uint64_t lanes[4];
+  _mm256_storeu_si256((__m256i *)lanes, acc);
+  return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+
+
+// 512 bit AVX-512 kernel with native vector popcount
+__attribute__((target("avx512f,avx512vpopcntdq")))
+static uint32_t sweepRange512(sweepJob_t const& job, uint32_t first, uint32_t last) {
+  __m512i acc = _mm512_setzero_si512();
+  for(uint32_t k = first; k < last; k += 8) {
+    sweepLane<u64x8_t, 8>(job, k);
+    for(unsigned j = 0; j < job.outputCount; j++) {
+      __m512i mask = _mm512_loadu_si512(&job.cares[j][k]);
+      __m512i buf = _mm512_loadu_si512(&job.scratch[job.outputSlots[j] * 8]);
+      __m512i target = _mm512_loadu_si512(&job.outputs[j][k]);
+      __m512i difference = _mm512_and_si512(_mm512_xor_si512(buf, target), mask);
+      acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(difference));
+    }
+  }
+  return _mm512_reduce_add_epi64(acc);
+}
+
+
+
+// Sum bit errors over a range of bitmaps with the selected kernel
+uint32_t sweepBitErrors(sweepJob_t const& job, uint32_t firstBitmap, uint32_t lastBitmap) {
+  laneWidth_t w = getLaneWidth();
+
+  // Round the end of the range up to a whole lane, padding bits are masked off
+  if(lastBitmap % w) {
+    lastBitmap += w - (lastBitmap % w);
+  }
+
+  // Dispatch
+  switch(w) {
+    case LANE_WIDTH_512: return sweepRange512(job, firstBitmap, lastBitmap);
+    case LANE_WIDTH_256: return sweepRange256(job, firstBitmap, lastBitmap);
+    case LANE_WIDTH_64:
+      if(__builtin_cpu_supports("popcnt")) {
+        return sweepRange64Popcnt(job, firstBitmap, lastBitmap);
+      } else {
+        return sweepRange64(job, firstBitmap, lastBitmap);
+      }
+    default:
+      err("Error, unrecognised sweep lane width.\n");
+      return 0;
+  }
+}
@@ -11,6 +11,7 @@ using namespace std;
 #include "config.hpp"
 #include "utils.hpp"
 #include "mpicga.hpp"
+#include "sweepKernel.hpp"
 #include "bitVector.hpp"
 #include "optparse.hpp"
 
@@ -46,14 +47,91 @@ OptionParser buildOptionParser(int argc, char **argv) {
                      "Path to file containing target pattern.",
                      {DEFAULT_PATTERN_PATH}));
 
+  options.Add(Option("generate", 'k', ARG_TYPE_STRING,
+                     "Generate the target from a built in kernel as kernel:width, e.g. 'mul:8', instead of reading the pattern file, 'none' to read it.",
+                     {DEFAULT_GENERATED_TARGET}));
+
   options.Add(Option("threadcount", 't', ARG_TYPE_INT,
                      "Number of threads per process for subpopulation processing.",
                      {DEFAULT_THREAD_COUNT}));
 
+  options.Add(Option("evaluator", 'e', ARG_TYPE_STRING,
+                     "Genome evaluation engine, 'sweep', 'incremental' or 'recursive'. Incremental needs steady state selection without sampling and an in memory table.",
+                     {DEFAULT_EVALUATOR}));
+
+  options.Add(Option("lanewidth", 'w', ARG_TYPE_STRING,
+                     "Sweep evaluator lane width in bits, 'auto', '64', '256' or '512'.",
+                     {DEFAULT_LANE_WIDTH}));
+
+  options.Add(Option("earlyexit", 'x', ARG_TYPE_BOOL,
+                     "Stop evaluating genomes once they are certain to rank last.",
+                     {DEFAULT_EARLY_EXIT}));
+
+  options.Add(Option("lambda", 'l', ARG_TYPE_INT,
+                     "Offspring per generation in (1+lambda) mode, 0 for steady state selection.",
+                     {DEFAULT_LAMBDA}));
+
+  options.Add(Option("samplebitmaps", 'y', ARG_TYPE_INT,
+                     "Screen offspring on a rotating sample of this many bitmaps before evaluating them in full, 0 to disable.",
+                     {DEFAULT_SAMPLE_BITMAPS}));
+
+  options.Add(Option("fitnesscache", 'c', ARG_TYPE_INT,
+                     "Evaluated active circuits remembered per subpopulation, 0 to disable.",
+                     {DEFAULT_FITNESS_CACHE}));
+
+  options.Add(Option("async", 'a', ARG_TYPE_BOOL,
+                     "Asynchronous island model, elites migrate around a ring without per cycle synchronisation.",
+                     {DEFAULT_ASYNC_MIGRATION}));
+
+  options.Add(Option("staleness", 'z', ARG_TYPE_INT,
+                     "Cycles the global best fitness may lag behind in asynchronous mode.",
+                     {DEFAULT_MAX_STALENESS}));
+
+  options.Add(Option("stopzeroerrors", 'Z', ARG_TYPE_BOOL,
+                     "Stop once any genome reproduces the target pattern exactly.",
+                     {DEFAULT_STOP_ZERO_ERRORS}));
+
+  options.Add(Option("stopchips", 'C', ARG_TYPE_INT,
+                     "Stop once an error free genome needs no more than this many 7400 chips, 0 to disable.",
+                     {DEFAULT_STOP_CHIPS}));
+
+  options.Add(Option("stoptime", 'T', ARG_TYPE_FLOAT,
+                     "Stop after this many seconds of evolution, 0 to disable.",
+                     {DEFAULT_STOP_TIME}));
+
+  options.Add(Option("stopstagnation", 'N', ARG_TYPE_INT,
+                     "Stop after this many cycles without improvement in best fitness, 0 to disable.",
+                     {DEFAULT_STOP_STAGNATION}));
+
+  options.Add(Option("tablebudget", 'm', ARG_TYPE_INT,
+                     "MiB of a binary truth table kept resident, larger tables are streamed, 0 for no limit.",
+                     {DEFAULT_TABLE_BUDGET}));
+
   return options;
 }
 
 
+// Convert an evaluator name to an evaluation engine
+genomeEvaluator_t parseEvaluator(string const name) {
+  if(name == "sweep") return GENOME_EVAL_SWEEP;
+  if(name == "recursive") return GENOME_EVAL_RECURSIVE;
+  if(name == "incremental") return GENOME_EVAL_INCREMENTAL;
+  cout << "Error, unrecognised evaluator '" << name << "'.\n";
+  exit(1);
+}
+
+
+// Convert a lane width name to a lane width
+laneWidth_t parseLaneWidth(string const name) {
+  if(name == "auto") return LANE_WIDTH_AUTO;
+  if(name == "64") return LANE_WIDTH_64;
+  if(name == "256") return LANE_WIDTH_256;
+  if(name == "512") return LANE_WIDTH_512;
+  cout << "Error, unrecognised lane width '" << name << "'.\n";
+  exit(1);
+}
+
+
 // Define the fitness function for subpopulations
 uint32_t subPopFF(subPopulationPerf_t perf) {
   return perf.bestGenomeFitness;
@@ -69,7 +147,7 @@ uint32_t genomeFF(genomePerf_t perf) {
 
 
 // Gets number of 7400 chips needed to implement logic
-inline uint32_t chipCount(genomePerf_t const& perf) {
+uint32_t chipCount(genomePerf_t perf) {
   uint32_t count = 0;
   count += perf.notCount / 6;   if(perf.nopCount % 6) count++;
   count += perf.andCount / 4;   if(perf.andCount % 4) count++;
@@ -110,9 +188,6 @@ int main(int argc, char **argv) {
   // Build the option parser
   OptionParser options = buildOptionParser(argc, argv);
 
-  // Load the pattern from file
-  truthTable target(options.Get("patternfile"));
-
   // Subpopulation distribution across ranks counts
   int subPopCount = options.Get("subpopcount");
   int totalGenerations = options.Get("totalgenerations");
@@ -122,8 +197,33 @@ int main(int argc, char **argv) {
   uint32_t generationsPerSubPopulation = totalGenerations / subPopCount;
   uint32_t cycleCount = (totalGenerations / subPopCount) / generationsPerCycle;
 
-  // Initialise MPI
-  MPI_Init(&argc, &argv);
+  // Initialise MPI, migrations are progressed from the main thread while OpenMP threads evolve
+  int threadSupport;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &threadSupport);
+  if(threadSupport < MPI_THREAD_FUNNELED) {
+    warn("Warning, MPI library does not support funneled threading.");
+  }
+
+  // Load the pattern from file, parsed on rank 0 and broadcast to the others
+  // Generated targets are built by every rank and never stored
+  string generatedTarget = options.Get("generate");
+  truthTable target = generatedTarget == "none" ? truthTable(options.Get("patternfile"), 0) : truthTable::generate(generatedTarget);
+  target.setResidentBudget((uint64_t)(int)options.Get("tablebudget") << 20, (int)options.Get("threadcount"));
+
+  // Select evaluation lane width
+  setLaneWidth(parseLaneWidth(options.Get("lanewidth")));
+
+  // Incremental buffers hold every gene over the whole table and are carried from parent to
+  // child by steady state selection alone, so streamed tables, (1+lambda) and screening are out
+  genomeEvaluator_t evaluator = parseEvaluator(options.Get("evaluator"));
+  if(evaluator == GENOME_EVAL_INCREMENTAL) {
+    if(target.isMapped() || target.isGenerated()) {
+      err("Error, the incremental evaluator needs the table in memory, not mapped or generated.");
+    }
+    if((int)options.Get("lambda") || (int)options.Get("samplebitmaps")) {
+      err("Error, the incremental evaluator only supports steady state selection without sampling.");
+    }
+  }
 
   // zeroth rank, print out run information
   if(myRank() == 0) {
@@ -132,6 +232,10 @@ int main(int argc, char **argv) {
     cout << "Generations per sub population: " << generationsPerSubPopulation << "\n";
     cout << "Generations per cycle: " << generationsPerCycle << "\n";
     cout << "Cycle count: " << cycleCount << "\n";
+    cout << "Lane width: " << getLaneWidth() * 64 << " bits\n";
+    cout << "Table: " << target.getPatternCount() << " patterns, ";
+    cout << (target.isMapped() ? "mapped" : target.isGenerated() ? "generated" : "in memory");
+    cout << ", " << target.getBlockBitmapCount() << " bitmaps per block\n";
     cout << "\n[POPULATION LAYOUT]\n";
     cout << "Genome length: " << genomeSize << "\n";
     cout << "Subpopulation size: " << subPopSize << "\n";
@@ -151,9 +255,20 @@ int main(int argc, char **argv) {
   p.getAlgorithm().setCrossoverCount(3);
   p.getAlgorithm().setSelectCount(0);
   p.getAlgorithm().setThreadCount(options.Get("threadcount"));
+  p.getAlgorithm().setAsynchronous(options.Get("async"));
+  p.getAlgorithm().setMaxStaleness((int)options.Get("staleness"));
+  p.getAlgorithm().setStopOnZeroErrors(options.Get("stopzeroerrors"));
+  p.getAlgorithm().setStopCost((int)options.Get("stopchips"), chipCount);
+  p.getAlgorithm().setStopTime((double)options.Get("stoptime"));
+  p.getAlgorithm().setStopStagnation((int)options.Get("stopstagnation"));
 
   // Subpopulation algorithm settings
   p.getAlgorithm().getSubPopulationAlgorithm().setMutateCount(1);
+  p.getAlgorithm().getSubPopulationAlgorithm().setEvaluator(evaluator);
+  p.getAlgorithm().getSubPopulationAlgorithm().setEarlyExit(options.Get("earlyexit"));
+  p.getAlgorithm().getSubPopulationAlgorithm().setLambda((int)options.Get("lambda"));
+  p.getAlgorithm().getSubPopulationAlgorithm().setSampleBitmaps((int)options.Get("samplebitmaps"));
+  p.getAlgorithm().getSubPopulationAlgorithm().setFitnessCacheSize((int)options.Get("fitnesscache"));
   p.getAlgorithm().getSubPopulationAlgorithm().setAllowableFunctions({
     GENE_FN_AND,
     GENE_FN_NAND,
@@ -171,9 +286,18 @@ int main(int argc, char **argv) {
 
   // Quick barrier to stop execution duration overwriting stuff
   MPI_Barrier(MPI_COMM_WORLD);
+  uint64_t cacheLookups, cacheHits;
+  p.getFitnessCacheStats(cacheLookups, cacheHits);
 
   // Print time difference
   if(myRank() == 0) {
+    if(p.getCyclesCompleted() < cycleCount) {
+      cout << "\nStop criteria met after " << p.getCyclesCompleted() << " of " << cycleCount << " cycles\n";
+    }
+    if(cacheLookups) {
+      cout << "\nFitness cache: " << cacheHits << " of " << cacheLookups << " lookups hit ("
+           << 100.0 * cacheHits / cacheLookups << "%), " << cacheHits << " evaluations saved\n";
+    }
     cout << "\nTotal execution time: " << endTime - startTime << "s\n";
   }
 
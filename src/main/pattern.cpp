@@ -1,68 +1,35 @@
 // Standard libs
 #include <iostream>
 #include <sstream>
+#include <algorithm>
+using namespace std;
 
 
 // Project headers
 #include "truthTable.hpp"
 
 
-// Generates a multiplier
-void generateMultiplier(string path, string widthStr) {
-
-  // Get width of multiplier
-  unsigned multiplierWidth;
-  stringstream ss(widthStr);
-  ss >> multiplierWidth;
-
-  // Calculate input and output counts, create the truth table
-  unsigned inputCount = multiplierWidth * 2;
-  unsigned outputCount = multiplierWidth * 2;
-  truthTable t(inputCount, outputCount);
-
-  // Fill the truth table with the multiplier pattern
-  unsigned patternCount = 0x01 << inputCount;
-  for(unsigned i = 0; i < patternCount; i++) {
-    unsigned a = i & ((0x01 << multiplierWidth) - 1);
-    unsigned b = (i >> multiplierWidth) & ((0x01 << multiplierWidth) - 1);
-    t.addPattern(make_pair(i, a * b));
+// Writes the table, in binary if the path ends with ".ttb"
+void writeTable(truthTable& t, string path) {
+  if(path.size() > 4 && path.compare(path.size() - 4, 4, ".ttb") == 0) {
+    t.writeBinaryFile(path);
+  } else {
+    t.writeToFile(path);
   }
-
-  // Output the pattern to the file
-  t.writeToFile(path);
 }
 
 
-// Generate an adder
-void generateAdder(string path, string widthStr, bool doCarry) {
+// Generates a table from a registered kernel
+void generateKernel(string path, string kernelName, string widthStr) {
 
-  // Get width of adder
-  unsigned adderWidth;
+  // Get operand width
+  unsigned width;
   stringstream ss(widthStr);
-  ss >> adderWidth;
-
-  // Determine input/output counts
-  unsigned inputCount = adderWidth * 2;
-  unsigned outputCount = adderWidth;
-  if(doCarry) {
-    inputCount++;
-    outputCount++;
-  }
-
-  // Instantiate
-  truthTable t(inputCount, outputCount);
+  ss >> width;
 
-  // Fill the truth table with the adder pattern
-  unsigned patternCount = (0x01 << inputCount);
-  for(unsigned i = 0; i < patternCount; i++) {
-    unsigned a = i & ((0x01 << adderWidth) - 1);
-    unsigned b = (i >> adderWidth) & ((0x01 << adderWidth) - 1);
-    unsigned c = (i >> (adderWidth * 2)) & 0x01;
-    t.addPattern(i, a + b + c);
-  }
-
-  // Write the pattern to the file
-  t.writeToFile(path);
+  // Generate the table and write it out, the columns are only built while writing
+  truthTable t = truthTable::generate(kernelName, width);
+  writeTable(t, path);
 }
 
 
@@ -72,31 +39,48 @@ int main(int argc, char** argv) {
   // Check that there are enough arguments
   if(argc < 3) {
     cout << "Usage: " << argv[0] << " [filename] [pattern] <pattern args>\n";
-    cout << "\t available patterns: add, mul.\n";
+    cout << "\t available patterns: add, convert";
+    vector<string> kernelNames = truthTable::getKernelNames();
+    for(unsigned i = 0; i < kernelNames.size(); i++) {
+      if(kernelNames[i] != "add") cout << ", " << kernelNames[i];
+    }
+    cout << ".\n";
+    cout << "\t kernel patterns take an operand width.\n";
+    cout << "\t files ending in .ttb are written in the binary format.\n";
     return 0;
   }
 
   // Process the arguments
-  if(string(argv[2]) == "mul") {
-    if(argc < 4) {
-      cout << "Usage: " << argv[2] << " <input width>\n";
-    } else {
-      generateMultiplier(string(argv[1]), string(argv[3]));
-    }
-
-  } else if (string(argv[2]) == "add") {
+  vector<string> kernelNames = truthTable::getKernelNames();
+  if(string(argv[2]) == "add") {
     if(argc < 5) {
       cout << "Usage: " << argv[2] << " <input width> <carry=true>\n";
     } else {
       if(string(argv[4]) == "carry=true") {
-        generateAdder(string(argv[1]), string(argv[3]), true);
+        generateKernel(string(argv[1]), "addc", string(argv[3]));
       } else if(string(argv[4]) == "carry=false") {
-        generateAdder(string(argv[1]), string(argv[3]), false);
+        generateKernel(string(argv[1]), "add", string(argv[3]));
       } else {
         cout << "Usage: " << argv[2] << " <input width> <carry=[true,false]>\n";
       }
     }
 
+  } else if (string(argv[2]) == "convert") {
+    if(argc < 4) {
+      cout << "Usage: " << argv[2] << " <source file>\n";
+    } else {
+      string source(argv[3]);
+      truthTable t(source);
+      writeTable(t, string(argv[1]));
+    }
+
+  } else if (find(kernelNames.begin(), kernelNames.end(), string(argv[2])) != kernelNames.end()) {
+    if(argc < 4) {
+      cout << "Usage: " << argv[2] << " <input width>\n";
+    } else {
+      generateKernel(string(argv[1]), string(argv[2]), string(argv[3]));
+    }
+
   } else {
     cout << "Unrecognised pattern: '" << argv[2] << "'\n";
   }
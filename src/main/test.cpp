@@ -1,14 +1,21 @@
 // C standard stuff
+#include <cstring>
 #include <exception>
+#include <fstream>
 #include <iostream>
+#include <vector>
+using namespace std;
 
 
 // Project headers
 #include "truthTable.hpp"
+#include "mpicga.hpp"
+#include "sweepKernel.hpp"
 
 
 // Test suite configuration
 #define CATCH_CONFIG_MAIN
+#define CATCH_CONFIG_NO_POSIX_SIGNALS
 #include "catch.hpp"
 
 
@@ -61,6 +68,181 @@ TEST_CASE("Truth table class test", "[truthTable]") {
     }
 
 
+    SECTION("Bulk added patterns match patterns added one at a time") {
+      truthTable bulk(inputCount, outputCount);
+      for(unsigned i = 0; i < 37; i++) {
+        bulk.addPattern(testPatterns[i]);
+      }
+      bulk.addPatterns(vector<pair<uint32_t, uint32_t>>(testPatterns.begin() + 37, testPatterns.end()));
+
+      unsigned errorCount = 0;
+      for(unsigned j = 0; j < t.getBitmapCount(); j++) {
+        for(unsigned i = 0; i < inputCount; i++)
+          if(bulk.getInputBitmap(i, j) != t.getInputBitmap(i, j)) errorCount++;
+        for(unsigned i = 0; i < outputCount; i++)
+          if(bulk.getOutputBitmap(i, j) != t.getOutputBitmap(i, j)) errorCount++;
+        if(bulk.getBitmapMask(j) != t.getBitmapMask(j)) errorCount++;
+      }
+
+      REQUIRE(bulk.getPatternCount() == t.getPatternCount());
+      REQUIRE(errorCount == 0);
+
+      bulk.releaseIndex();
+      bulk.addPattern(testPatterns[5]);
+      REQUIRE(bulk.getPatternCount() == t.getPatternCount());
+      REQUIRE_THROWS(bulk.addPattern(testPatterns[5].first, testPatterns[5].second ^ 0x01));
+    }
+
+
+    SECTION("Generated tables match tables built from patterns") {
+      truthTable generated = truthTable::generate("mul:" + to_string(multiplierWidth));
+      REQUIRE(generated.getInputCount() == inputCount);
+      REQUIRE(generated.getOutputCount() == outputCount);
+      REQUIRE(generated.getPatternCount() == t.getPatternCount());
+
+      unsigned errorCount = 0;
+      for(unsigned i = 0; i < testPatterns.size(); i++)
+        if(generated.getPattern(i) != testPatterns[i]) errorCount++;
+      for(unsigned j = 0; j < t.getBitmapCount(); j++) {
+        for(unsigned i = 0; i < inputCount; i++)
+          if(generated.getInputBitmap(i, j) != t.getInputBitmap(i, j)) errorCount++;
+        for(unsigned i = 0; i < outputCount; i++)
+          if(generated.getOutputBitmap(i, j) != t.getOutputBitmap(i, j)) errorCount++;
+      }
+
+      truthTableBlock_t block;
+      generated.getBlock(0, block);
+      REQUIRE(block.counterInputs);
+      for(unsigned k = 0; k < block.bitmapCount; k++) {
+        for(unsigned i = 0; i < outputCount; i++)
+          if(block.outputs[i][k] != t.getOutputBitmap(i, k) || block.cares[i][k] != t.getBitmapMask(k)) errorCount++;
+      }
+      REQUIRE(errorCount == 0);
+
+      // Bitmaps of another generated table read in between come from their own table
+      truthTable smaller = truthTable::generate("mul:2");
+      uint64_t smallerBitmap = 0;
+      for(unsigned p = 0; p < smaller.getPatternCount(); p++)
+        if(smaller.getPattern(p).second & 0x01) smallerBitmap |= (uint64_t)0x01 << (63 - p);
+      for(unsigned j = 0; j < t.getBitmapCount(); j++) {
+        if(smaller.getOutputBitmap(0, 0) != smallerBitmap) errorCount++;
+        if(generated.getOutputBitmap(1, j) != t.getOutputBitmap(1, j)) errorCount++;
+      }
+      REQUIRE(errorCount == 0);
+
+      // Raw columns only once the table is explicitly materialised
+      REQUIRE_THROWS(generated.getOutputBitmaps(0));
+      generated.materialise();
+      REQUIRE(!generated.isGenerated());
+      for(unsigned j = 0; j < t.getBitmapCount(); j++) {
+        for(unsigned i = 0; i < inputCount; i++)
+          if(generated.getInputBitmaps(i)[j] != t.getInputBitmap(i, j)) errorCount++;
+        for(unsigned i = 0; i < outputCount; i++)
+          if(generated.getOutputBitmaps(i)[j] != t.getOutputBitmap(i, j)) errorCount++;
+      }
+      REQUIRE(errorCount == 0);
+
+      REQUIRE_THROWS(truthTable::generate("mul:16"));
+      REQUIRE_THROWS(truthTable::generate("nonexistent:4"));
+    }
+
+
+    SECTION("Complete tables in counting order are detected") {
+      REQUIRE(t.hasCounterInputs());
+
+      truthTable reversed(inputCount, outputCount);
+      truthTable incomplete(inputCount, outputCount);
+      for(unsigned i = 0; i < testPatterns.size(); i++) {
+        reversed.addPattern(testPatterns[testPatterns.size() - 1 - i]);
+        if(i != 3) incomplete.addPattern(testPatterns[i]);
+      }
+      REQUIRE(reversed.getPatternCount() == t.getPatternCount());
+      REQUIRE_FALSE(reversed.hasCounterInputs());
+      REQUIRE_FALSE(incomplete.hasCounterInputs());
+
+      unsigned errorCount = 0;
+      for(unsigned j = 0; j < t.getBitmapCount(); j++)
+        for(unsigned i = 0; i < inputCount; i++)
+          if(t.getInputBitmap(i, j) != t.getInputBitmaps(i)[j]) errorCount++;
+      REQUIRE(errorCount == 0);
+    }
+
+
+    SECTION("Don't care outputs survive text and binary files") {
+      truthTable partial(inputCount, outputCount);
+      unsigned caredCount = 0;
+      for(unsigned i = 0; i < testPatterns.size(); i++) {
+        uint32_t careMask = i % 7 ? ~0 : i % 4;
+        partial.addPattern(testPatterns[i].first, testPatterns[i].second, careMask);
+        if(careMask) caredCount++;
+      }
+      partial.writeToFile("test.pat");
+      truthTable text("test.pat");
+      partial.writeBinaryFile("test.ttb");
+      truthTable binary("test.ttb");
+
+      unsigned errorCount = 0;
+      for(unsigned i = 0; i < partial.getPatternCount(); i++) {
+        if(text.getPattern(i) != partial.getPattern(i) || text.getCareMask(i) != partial.getCareMask(i)) errorCount++;
+        if(binary.getPattern(i) != partial.getPattern(i) || binary.getCareMask(i) != partial.getCareMask(i)) errorCount++;
+      }
+
+      REQUIRE(partial.getPatternCount() == caredCount);
+      REQUIRE(text.getPatternCount() == partial.getPatternCount());
+      REQUIRE(binary.getPatternCount() == partial.getPatternCount());
+      REQUIRE(errorCount == 0);
+    }
+
+
+    SECTION("Binary files with a corrupt header are rejected") {
+      truthTable counter(4, 1);
+      for(unsigned i = 0; i < 16; i++) counter.addPattern(i, i % 3 == 0);
+      counter.writeBinaryFile("test.ttb");
+      ifstream in("test.ttb", ios::binary);
+      string image((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+      truthTableBinaryHeader_t header;
+      memcpy(&header, image.data(), sizeof(header));
+      REQUIRE((header.flags & TRUTH_TABLE_BINARY_FLAG_COUNTER) != 0);
+
+      // Too many inputs, more patterns than inputs allow, and inputs out of counting order
+      for(unsigned k = 0; k < 3; k++) {
+        string corrupt = image;
+        truthTableBinaryHeader_t *bad = (truthTableBinaryHeader_t *)&corrupt[0];
+        if(k == 0) bad->inputCount = 40;
+        if(k == 1) bad->patternCount = 17;
+        if(k == 2) corrupt[sizeof(header)] ^= 0x01;
+        ofstream out("test.ttb", ios::binary | ios::trunc);
+        out.write(corrupt.data(), corrupt.size());
+        out.close();
+        REQUIRE_THROWS(truthTable("test.ttb"));
+      }
+    }
+
+
+    SECTION("Redefinitions caring about more outputs merge into the existing pattern") {
+      truthTable single(2, 2);
+      single.addPattern(1, 2, 2);
+      single.addPattern(1, 0, 1);
+      single.addPattern(1, 2, 3);
+
+      // Merged into rows already in the table and rows from the same batch
+      truthTable bulk(2, 2);
+      bulk.addPattern(1, 2, 2);
+      vector<pair<uint32_t, uint32_t>> batch = {make_pair(1, 0), make_pair(2, 1), make_pair(2, 0)};
+      bulk.addPatterns(batch, {1, 1, 2});
+
+      unsigned errorCount = 0;
+      if(single.getPattern(0) != make_pair((uint32_t)1, (uint32_t)2) || single.getCareMask(0) != 3) errorCount++;
+      if(bulk.getPattern(0) != make_pair((uint32_t)1, (uint32_t)2) || bulk.getCareMask(0) != 3) errorCount++;
+      if(bulk.getPattern(1) != make_pair((uint32_t)2, (uint32_t)1) || bulk.getCareMask(1) != 3) errorCount++;
+
+      REQUIRE(single.getPatternCount() == 1);
+      REQUIRE(bulk.getPatternCount() == 2);
+      REQUIRE(errorCount == 0);
+      REQUIRE_THROWS(single.addPattern(1, 0, 2));
+    }
+
+
     SECTION("Correct recall of saved patterns") {
       t.writeToFile("test.pat");
       t = truthTable("test.pat");
@@ -73,3 +255,404 @@ TEST_CASE("Truth table class test", "[truthTable]") {
     }
   }
 }
+
+
+
+// Fitness function for evaluator tests
+uint32_t bitErrorFitness(genomePerf_t perf) {
+  return perf.bitErrors;
+}
+
+
+
+TEST_CASE("Genome evaluator equivalence test", "[genome]") {
+
+  unsigned multiplierWidth = 3;
+  unsigned inputCount = multiplierWidth * 2;
+  unsigned outputCount = multiplierWidth * 2;
+  unsigned patternCount = 0x01 << inputCount;
+
+  truthTable t(inputCount, outputCount);
+  for(unsigned i = 0; i < patternCount; i++) {
+    unsigned a = i & ((0x01 << multiplierWidth) - 1);
+    unsigned b = (i >> multiplierWidth) & ((0x01 << multiplierWidth) - 1);
+    t.addPattern(i, a * b);
+  }
+
+  subPopulationAlgorithm algorithm(4, 256);
+  algorithm.setSeed(7);
+  algorithm.setAllowableFunctions({GENE_FN_AND, GENE_FN_NAND, GENE_FN_OR, GENE_FN_NOR,
+                                   GENE_FN_XOR, GENE_FN_XNOR, GENE_FN_NOT, GENE_FN_NOP});
+
+  SECTION("Sweep and incremental evaluators match the recursive evaluator") {
+    genomeEvaluator_t evaluators[2] = {GENOME_EVAL_SWEEP, GENOME_EVAL_INCREMENTAL};
+    unsigned mismatchCount = 0;
+    for(unsigned e = 0; e < 2; e++) {
+      for(unsigned i = 0; i < 16; i++) {
+        genome g(algorithm.getGenomeLength(), algorithm);
+        g.setEvaluator(evaluators[e]);
+        for(unsigned j = 0; j < 32; j++) {
+          genome r = g;
+          r.setEvaluator(GENOME_EVAL_RECURSIVE);
+          genomePerf_t rp = r.getPerfData(t);
+          genomePerf_t ep = g.getPerfData(t);
+          if(rp.bitErrors != ep.bitErrors) mismatchCount++;
+          if(rp.activeGenes != ep.activeGenes) mismatchCount++;
+          if(rp.xorCount != ep.xorCount || rp.notCount != ep.notCount) mismatchCount++;
+          g.mutate(algorithm);
+        }
+      }
+    }
+
+    REQUIRE(mismatchCount == 0);
+  }
+
+  SECTION("Budgeted evaluation accepts within budget and rejects certain losers") {
+    unsigned mismatchCount = 0;
+    for(unsigned i = 0; i < 16; i++) {
+      genome g(algorithm.getGenomeLength(), algorithm);
+      genome b = g;
+      uint32_t fitness = bitErrorFitness(g.getPerfData(t));
+      if(!b.evaluateWithinBudget(t, bitErrorFitness, fitness)) mismatchCount++;
+      if(bitErrorFitness(b.getPerfData(t)) != fitness) mismatchCount++;
+      b = g;
+      b.setEvaluator(GENOME_EVAL_SWEEP);
+      if(fitness && b.evaluateWithinBudget(t, bitErrorFitness, fitness - 1)) mismatchCount++;
+    }
+
+    REQUIRE(mismatchCount == 0);
+  }
+
+  SECTION("Offspring held as mutation lists match mutated copies") {
+    algorithm.setMutateCount(3);
+    unsigned mismatchCount = 0;
+    vector<geneMutation_t> mutations;
+    for(unsigned i = 0; i < 32; i++) {
+      genome parent(algorithm.getGenomeLength(), algorithm);
+      genome child = parent;
+      genome adopted = parent;
+      uint32_t fitness = bitErrorFitness(parent.getPerfData(t));
+
+      subPopulationAlgorithm replay = algorithm;
+      child.mutate(replay);
+      parent.drawMutations(algorithm, mutations);
+
+      genomePerf_t perf;
+      bool kept = parent.evaluateOffspring(t, mutations, bitErrorFitness, fitness, perf);
+      if(kept != (bitErrorFitness(child.getPerfData(t)) <= fitness)) mismatchCount++;
+      if(bitErrorFitness(parent.getPerfData(t)) != fitness) mismatchCount++;
+      if(kept) {
+        adopted.adoptOffspring(t, parent, mutations, perf);
+        if(adopted.getFunctions() != child.getFunctions()) mismatchCount++;
+        if(adopted.getAIndices() != child.getAIndices()) mismatchCount++;
+        if(adopted.getBIndices() != child.getBIndices()) mismatchCount++;
+        if(adopted.getPerfData(t).bitErrors != child.getPerfData(t).bitErrors) mismatchCount++;
+      }
+    }
+    algorithm.setMutateCount(1);
+
+    REQUIRE(mismatchCount == 0);
+  }
+
+  SECTION("Offspring of incremental genomes carry their buffers and match the recursive evaluator") {
+    algorithm.setMutateCount(3);
+    unsigned mismatchCount = 0;
+    vector<geneMutation_t> mutations;
+    genome parent(algorithm.getGenomeLength(), algorithm);
+    genome adopted = parent;
+    parent.setEvaluator(GENOME_EVAL_INCREMENTAL);
+    adopted.setEvaluator(GENOME_EVAL_INCREMENTAL);
+    for(unsigned i = 0; i < 64; i++) {
+      uint32_t fitness = bitErrorFitness(parent.getPerfData(t));
+      parent.drawMutations(algorithm, mutations);
+
+      genome child = parent;
+      child.deriveFrom(parent, mutations);
+      child.setEvaluator(GENOME_EVAL_RECURSIVE);
+      genomePerf_t perf;
+      parent.evaluateOffspring(t, mutations, bitErrorFitness, UINT32_MAX, perf);
+      if(perf.bitErrors != child.getPerfData(t).bitErrors) mismatchCount++;
+      if(perf.activeGenes != child.getPerfData(t).activeGenes) mismatchCount++;
+      if(bitErrorFitness(parent.getPerfData(t)) != fitness) mismatchCount++;
+
+      // The adopted offspring's carried buffers stay correct under further mutation
+      adopted.adoptOffspring(t, parent, mutations, perf);
+      adopted.mutate(algorithm);
+      genome r = adopted;
+      r.setEvaluator(GENOME_EVAL_RECURSIVE);
+      if(adopted.getPerfData(t).bitErrors != r.getPerfData(t).bitErrors) mismatchCount++;
+      std::swap(parent, adopted);
+    }
+    algorithm.setMutateCount(1);
+
+    REQUIRE(mismatchCount == 0);
+  }
+
+  SECTION("Cached fitness matches evaluation and evicts the least recently used") {
+    fitnessCache cache;
+    cache.setCapacity(2);
+    uint32_t bitErrors = 0;
+    cache.insert(1, 11, 10);
+    cache.insert(2, 22, 20);
+    REQUIRE(cache.lookup(1, 11, bitErrors));
+    REQUIRE(bitErrors == 10);
+    cache.insert(3, 33, 30);
+    REQUIRE(!cache.lookup(2, 22, bitErrors));
+    REQUIRE(cache.lookup(1, 11, bitErrors));
+    REQUIRE(cache.lookup(3, 33, bitErrors));
+    REQUIRE(cache.getHitCount() == 3);
+    REQUIRE(cache.getLookupCount() == 4);
+
+    // A key collision between different programs misses
+    bitErrors = 0;
+    REQUIRE(!cache.lookup(3, 34, bitErrors));
+    REQUIRE(bitErrors == 0);
+    REQUIRE(cache.getHitCount() == 3);
+
+    // Genomes evaluated twice through the cache hit the second time with the same result
+    cache.setCapacity(64);
+    unsigned mismatchCount = 0;
+    for(unsigned i = 0; i < 16; i++) {
+      genome g(algorithm.getGenomeLength(), algorithm);
+      genome a = g, b = g;
+      vector<genome *> batch = {&a};
+      genome::evaluateBatch(t, batch, NULL, 0, NULL, &cache);
+      batch[0] = &b;
+      genome::evaluateBatch(t, batch, NULL, 0, NULL, &cache);
+      if(a.getPerfData(t).bitErrors != g.getPerfData(t).bitErrors) mismatchCount++;
+      if(b.getPerfData(t).bitErrors != g.getPerfData(t).bitErrors) mismatchCount++;
+      if(b.getPerfData(t).activeGenes != g.getPerfData(t).activeGenes) mismatchCount++;
+    }
+    REQUIRE(cache.getHitCount() >= 3 + 16);
+    REQUIRE(mismatchCount == 0);
+  }
+
+  SECTION("Screened offspring are rejected or evaluated exactly") {
+    truthTable m = truthTable::generate("mul", 6);
+    uint32_t laneCount = m.getLaneBitmapCount() / BITVECTOR_LANE_WORDS;
+    sampleScreen_t every, some;
+    for(unsigned k = 0; k < laneCount; k++) {
+      every.bitmaps.push_back(k * BITVECTOR_LANE_WORDS);
+    }
+    every.scale = 1;
+    some.bitmaps = {BITVECTOR_LANE_WORDS, 5 * BITVECTOR_LANE_WORDS};
+    some.scale = (double)laneCount / some.bitmaps.size();
+
+    // A sample of every lane is exact, so screening over it changes no decision
+    algorithm.setMutateCount(3);
+    unsigned mismatchCount = 0;
+    vector<geneMutation_t> mutations;
+    for(unsigned i = 0; i < 32; i++) {
+      genome parent(algorithm.getGenomeLength(), algorithm);
+      uint32_t fitness = bitErrorFitness(parent.getPerfData(m));
+      every.parentBitErrors = some.parentBitErrors = parent.getPerfData(m).bitErrors;
+      every.parentSampleErrors = parent.sampleBitErrors(m, every.bitmaps);
+      some.parentSampleErrors = parent.sampleBitErrors(m, some.bitmaps);
+      if(every.parentSampleErrors != every.parentBitErrors) mismatchCount++;
+      parent.drawMutations(algorithm, mutations);
+
+      genomePerf_t perf, everyPerf, somePerf;
+      bool kept = parent.evaluateOffspring(m, mutations, bitErrorFitness, fitness, perf);
+      if(parent.evaluateOffspring(m, mutations, bitErrorFitness, fitness, everyPerf, &every) != kept) mismatchCount++;
+      if(parent.evaluateOffspring(m, mutations, bitErrorFitness, fitness, somePerf, &some)) {
+        if(!kept || somePerf.bitErrors != perf.bitErrors) mismatchCount++;
+      }
+    }
+    algorithm.setMutateCount(1);
+
+    REQUIRE(mismatchCount == 0);
+  }
+
+  SECTION("Don't care outputs are ignored by every evaluator") {
+    truthTable dontCare(inputCount, outputCount);
+    for(unsigned i = 0; i < patternCount; i++) {
+      unsigned a = i & ((0x01 << multiplierWidth) - 1);
+      unsigned b = (i >> multiplierWidth) & ((0x01 << multiplierWidth) - 1);
+      dontCare.addPattern(i, a * b, i % 3 ? 0x3f : i % 5);
+    }
+
+    genomeEvaluator_t evaluators[2] = {GENOME_EVAL_SWEEP, GENOME_EVAL_INCREMENTAL};
+    unsigned mismatchCount = 0;
+    for(unsigned e = 0; e < 2; e++) {
+      for(unsigned i = 0; i < 16; i++) {
+        genome g(algorithm.getGenomeLength(), algorithm);
+        g.setEvaluator(evaluators[e]);
+        genome r = g;
+        r.setEvaluator(GENOME_EVAL_RECURSIVE);
+        uint32_t errors = r.getPerfData(dontCare).bitErrors;
+        if(errors != g.getPerfData(dontCare).bitErrors) mismatchCount++;
+        if(errors > r.getPerfData(t).bitErrors) mismatchCount++;
+      }
+    }
+
+    REQUIRE(dontCare.getPatternCount() < patternCount);
+    REQUIRE(mismatchCount == 0);
+  }
+
+  SECTION("Every supported lane width matches the recursive evaluator") {
+
+    // Partial 5 bit multiplier, last bitmap is not full and not lane aligned
+    truthTable partial(10, 10);
+    for(unsigned i = 0; i < 1000; i++) {
+      partial.addPattern(i, (i & 0x1f) * (i >> 5));
+    }
+
+    laneWidth_t widths[3] = {LANE_WIDTH_64, LANE_WIDTH_256, LANE_WIDTH_512};
+    unsigned mismatchCount = 0;
+    for(unsigned w = 0; w < 3 && widths[w] <= supportedLaneWidth(); w++) {
+      setLaneWidth(widths[w]);
+      for(unsigned i = 0; i < 16; i++) {
+        genome g(algorithm.getGenomeLength(), algorithm);
+        g.setEvaluator(GENOME_EVAL_SWEEP);
+        genome r = g;
+        r.setEvaluator(GENOME_EVAL_RECURSIVE);
+        if(r.getPerfData(partial).bitErrors != g.getPerfData(partial).bitErrors) mismatchCount++;
+      }
+    }
+    setLaneWidth(LANE_WIDTH_AUTO);
+
+    REQUIRE(mismatchCount == 0);
+  }
+
+  SECTION("Tables split into several blocks match the recursive evaluator") {
+
+    // Half of a 7 bit multiplier out of counting order, with some don't cares
+    vector<pair<uint32_t, uint32_t>> patterns;
+    vector<uint32_t> careMasks;
+    for(unsigned i = 0; i < 0x01 << 13; i++) {
+      uint32_t input = (i * 5) & 0x3fff;
+      patterns.push_back(make_pair(input, (input & 0x7f) * (input >> 7)));
+      careMasks.push_back(i % 7 ? ~0 : 0x1555);
+    }
+    truthTable memory(14, 14);
+    memory.addPatterns(patterns, careMasks);
+    memory.writeBinaryFile("test.ttb");
+    truthTable mapped("test.ttb");
+
+    // The smallest budget leaves a lane per block
+    truthTable *tables[2] = {&memory, &mapped};
+    unsigned mismatchCount = 0;
+    for(unsigned k = 0; k < 2; k++) {
+      truthTable& table = *tables[k];
+      table.setResidentBudget(1);
+      if(table.getBlockBitmapCount() * 4 > table.getBitmapCount()) mismatchCount++;
+
+      vector<uint32_t> every;
+      for(unsigned j = 0; j < table.getLaneBitmapCount(); j += BITVECTOR_LANE_WORDS) {
+        every.push_back(j);
+      }
+
+      vector<genome> genomes, batched;
+      for(unsigned i = 0; i < 16; i++) {
+        genomes.push_back(genome(algorithm.getGenomeLength(), algorithm));
+      }
+      batched = genomes;
+      vector<genome *> batch;
+      for(unsigned i = 0; i < batched.size(); i++) {
+        batch.push_back(&batched[i]);
+      }
+      genome::evaluateBatch(table, batch);
+
+      for(unsigned i = 0; i < genomes.size(); i++) {
+        genome g = genomes[i];
+        g.setEvaluator(GENOME_EVAL_SWEEP);
+        genome r = genomes[i];
+        r.setEvaluator(GENOME_EVAL_RECURSIVE);
+        uint32_t errors = r.getPerfData(table).bitErrors;
+        if(g.getPerfData(table).bitErrors != errors) mismatchCount++;
+        if(batched[i].getPerfData(table).bitErrors != errors) mismatchCount++;
+        if(genomes[i].sampleBitErrors(table, every) != errors) mismatchCount++;
+      }
+    }
+
+    REQUIRE(mapped.isMapped());
+    REQUIRE(mismatchCount == 0);
+  }
+
+  SECTION("Genomes survive packing into a transmit buffer and bulk copying") {
+    genome g(algorithm.getGenomeLength(), algorithm);
+    genome h(algorithm.getGenomeLength(), algorithm);
+    genome k(algorithm.getGenomeLength(), algorithm);
+
+    genomeTransmissionBuffer txBuffer(g.getGeneCount(), 2);
+    txBuffer.append(g);
+    g.getPerfData(t);
+    txBuffer.append(g);
+    txBuffer.extract(h);
+    k.copyFrom(h);
+
+    REQUIRE(k.getFunctions() == g.getFunctions());
+    REQUIRE(k.getAIndices() == g.getAIndices());
+    REQUIRE(k.getBIndices() == g.getBIndices());
+    REQUIRE(k.getPerfData(t).bitErrors == g.getPerfData(t).bitErrors);
+
+    // Once evaluated only the active genes are packed, over a genome with different inactive genes
+    genome m(algorithm.getGenomeLength(), algorithm);
+    txBuffer.extract(m);
+    REQUIRE(m.getPerfData(t).bitErrors == g.getPerfData(t).bitErrors);
+    REQUIRE(m.getPerfData(t).activeGenes == g.getPerfData(t).activeGenes);
+  }
+
+  SECTION("(1+lambda) generations keep the elite and replace the worst genome with neutral or better offspring") {
+
+    // Subpopulations are placed on MPI processes, the suite runs as a single process
+    int mpiInitialised;
+    MPI_Initialized(&mpiInitialised);
+    if(!mpiInitialised) {
+      MPI_Init(NULL, NULL);
+    }
+
+    algorithm.setLambda(2);
+    subPopulation sp(algorithm);
+    sp.initialise(t, bitErrorFitness);
+    vector<genome>& genomes = sp.getGenomes();
+
+    // Replay each generation's offspring to know which genome should change and how
+    unsigned mismatchCount = 0, neutralCount = 0, worseCount = 0;
+    uint32_t bestFitness = sp.getPerfData().bestGenomeFitness;
+    for(unsigned n = 0; n < 256; n++) {
+      vector<genome> before = genomes;
+      unsigned elite = 0, worst = 0;
+      for(unsigned i = 1; i < genomes.size(); i++) {
+        if(genomes[i].getPerfData(t).bitErrors < genomes[elite].getPerfData(t).bitErrors) elite = i;
+        if(genomes[i].getPerfData(t).bitErrors >= genomes[worst].getPerfData(t).bitErrors) worst = i;
+      }
+      uint32_t eliteFitness = bitErrorFitness(genomes[elite].getPerfData(t));
+
+      // Best offspring, first wins ties, as drawn from a copy of the generator
+      subPopulationAlgorithm replay = sp.getAlgorithm();
+      vector<geneMutation_t> mutations;
+      genome offspring = genomes[elite], child = genomes[elite];
+      uint32_t offspringFitness = UINT32_MAX;
+      for(unsigned i = 0; i < replay.getLambda(); i++) {
+        genomes[elite].drawMutations(replay, mutations);
+        child.deriveFrom(genomes[elite], mutations);
+        if(bitErrorFitness(child.getPerfData(t)) < offspringFitness) {
+          offspringFitness = bitErrorFitness(child.getPerfData(t));
+          offspring = child;
+        }
+      }
+
+      sp.iterate(t, bitErrorFitness);
+
+      // Neutral or better offspring replace the worst genome, worse ones leave every genome alone
+      for(unsigned i = 0; i < genomes.size(); i++) {
+        genome const& expected = (i == worst && offspringFitness <= eliteFitness) ? offspring : before[i];
+        if(genomes[i].getFunctions() != expected.getFunctions()) mismatchCount++;
+        if(genomes[i].getAIndices() != expected.getAIndices()) mismatchCount++;
+        if(genomes[i].getBIndices() != expected.getBIndices()) mismatchCount++;
+      }
+      neutralCount += offspringFitness == eliteFitness;
+      worseCount += offspringFitness > eliteFitness;
+
+      // The best fitness never gets worse
+      if(sp.getPerfData().bestGenomeFitness > bestFitness) mismatchCount++;
+      bestFitness = sp.getPerfData().bestGenomeFitness;
+    }
+    algorithm.setLambda(0);
+
+    REQUIRE(neutralCount > 0);
+    REQUIRE(worseCount > 0);
+    REQUIRE(mismatchCount == 0);
+  }
+}
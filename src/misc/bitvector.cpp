@@ -4,6 +4,7 @@
 #include <string>
 #include <sstream>
 #include <iomanip>
+#include <algorithm>
 using namespace std;
 
 
@@ -40,9 +41,12 @@ void bitVector::init(uint32_t l) {
     this->length = l;
     this->bitmaps.clear();
 
-    // Calculate number of bitmaps required to serve as base storage
+    // Calculate number of bitmaps required to serve as base storage, padded to whole lanes
     uint32_t bitmapCount = this->length / 64;
     if(this->length % 64) bitmapCount++;
+    if(bitmapCount % BITVECTOR_LANE_WORDS) {
+        bitmapCount += BITVECTOR_LANE_WORDS - (bitmapCount % BITVECTOR_LANE_WORDS);
+    }
     this->bitmaps.reserve(bitmapCount);
     for(unsigned i = 0; i < bitmapCount; i++) {
         this->bitmaps.push_back(0);
@@ -50,6 +54,14 @@ void bitVector::init(uint32_t l) {
 }
 
 
+// Initialise the bit vector to given width from raw bitmaps
+// Data must hold the padded storage, as returned by getBitmapData
+void bitVector::assign(uint32_t l, const uint64_t *data) {
+    this->init(l);
+    std::copy(data, data + this->bitmaps.size(), this->bitmaps.begin());
+}
+
+
 // Returns bitmap index for a given bit number
 uint32_t bitVector::bitmapIndex(uint32_t bitIndex) {
     return bitIndex / 64;
@@ -66,7 +78,7 @@ uint32_t bitVector::bitmapOffset(uint32_t bitIndex) {
 uint64_t bitVector::bitmapMask(uint32_t bitmapIndex) {
 
     // Calculate maximum allowable index
-    uint32_t maxIndex = bitmaps.size() - 1;
+    uint32_t maxIndex = this->getBitmapCount() - 1;
     uint64_t mask;
 
     // Return the apropriate mask
@@ -93,7 +105,7 @@ string bitVector::str(uint8_t format) {
 
         // Hexadecimal
         case BITVECTOR_FORMAT_HEX:
-            for(unsigned i = 0; i < this->bitmaps.size(); i++) {
+            for(unsigned i = 0; i < this->getBitmapCount(); i++) {
                 ss << hex << setfill('0') << setw(16) << (uint64_t)this->bitmaps[i];
             }
             break;
@@ -122,7 +134,7 @@ string bitVector::str(uint8_t format) {
 
 // Get bitmap in the input bitmap vector
 uint64_t bitVector::getBitmap(uint32_t bitmapIndex) {
-    if(bitmapIndex >= this->bitmaps.size()) {
+    if(bitmapIndex >= this->getBitmapCount()) {
         cout << "Error, attempt to access bitmap beyond range.\n";
         exit(1);
     }
@@ -132,7 +144,7 @@ uint64_t bitVector::getBitmap(uint32_t bitmapIndex) {
 
 // Set a bitmap in the input bitmap vector
 void bitVector::setBitmap(uint32_t bitmapIndex, uint64_t bitmapValue) {
-    if(bitmapIndex >= this->bitmaps.size()) {
+    if(bitmapIndex >= this->getBitmapCount()) {
         cout << "Error, attempt to access bitmap beyond range.\n";
         exit(1);
     }
@@ -194,9 +206,9 @@ void bitVector::appendBit(uint8_t bitValue) {
     uint32_t requiredBitmaps = this->length / 64;
     if(this->length % 64) requiredBitmaps++;
 
-    // Add a bitmap if neccessary
+    // Add a lane of bitmaps if neccessary
     if(this->bitmaps.size() < requiredBitmaps) {
-        bitmaps.push_back(0);
+        bitmaps.resize(this->bitmaps.size() + BITVECTOR_LANE_WORDS, 0);
     }
 
     // Write bit
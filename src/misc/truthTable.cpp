@@ -1,11 +1,20 @@
 // Standard headers
 #include <iostream>
 #include <sstream>
+#include <cstring>
+#include <climits>
+#include <algorithm>
+#include <exception>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 using namespace std;
 
 
 // Project headers
 #include "truthTable.hpp"
+#include "mpi.h"
 
 
 //========[FILE PARSING CLASS]===================================================================//
@@ -15,38 +24,54 @@ using namespace std;
 const string TTfp::whiteSpaceChars = " \t\n";
 const string TTfp::numberChars = "0123456789abcdefABCDEF";
 const string TTfp::nameChars = "ABCDEFGHIJKLMNOPGRSTUVWXYZabcdefghijklmnopqrstuvwxyz_0123456789";
+const string TTfp::dontCareChars = "xX-";
+uint8_t TTfp::charClass[256];
+uint8_t TTfp::digitValue[256];
+
+
+// Size of the chunks the file is read in
+#define TTFP_CHUNK_SIZE (1 << 20)
+
+
+// Build the character class and digit value tables
+void TTfp::buildTables(void) {
+    memset(charClass, 0, sizeof(charClass));
+    memset(digitValue, 0xff, sizeof(digitValue));
+    for(unsigned i = 0; i < whiteSpaceChars.size(); i++) charClass[(uint8_t)whiteSpaceChars[i]] |= TTFP_CHAR_WHITESPACE;
+    for(unsigned i = 0; i < numberChars.size(); i++) charClass[(uint8_t)numberChars[i]] |= TTFP_CHAR_NUMBER;
+    for(unsigned i = 0; i < nameChars.size(); i++) charClass[(uint8_t)nameChars[i]] |= TTFP_CHAR_NAME;
+    for(unsigned i = 0; i < dontCareChars.size(); i++) charClass[(uint8_t)dontCareChars[i]] |= TTFP_CHAR_DONT_CARE;
+    for(unsigned i = 0; i < 16; i++) {
+        digitValue[(uint8_t)numberChars[i]] = i;
+        digitValue[(uint8_t)toupper(numberChars[i])] = i;
+    }
+}
 
 
-// Constructor, opens the file
+// Constructor, reads the file
 TTfp::TTfp(string path) {
 
     // Open the file for reading
-    this->fp.open(path);
+    ifstream fp(path, ios::binary);
 
     // Check that the file is indeed open
     if(!fp.is_open()) {
         throw(runtime_error("Could not open file '" + path + "' for reading."));
     }
 
-    // Reset line and column info
-    this->line = 1;
-    this->column = 0;
-}
-
-
-// Return the currently pointed to character
-char TTfp::current(void) {
-    return this->fp.peek();
-}
-
-
-// Advance the pointer
-void TTfp::advance(void) {
-    if(this->fp.get() == '\n') {
-        this->column = 0;
-        this->line++;
-    } else {
-        this->column++;
+    // Read the whole file in large chunks
+    size_t size = 0;
+    do {
+        this->text.resize(size + TTFP_CHUNK_SIZE);
+        fp.read(&this->text[size], TTFP_CHUNK_SIZE);
+        size += fp.gcount();
+    } while(fp);
+    this->text.resize(size);
+    this->position = 0;
+
+    // Character tables are built on first use
+    if(!charClass[(uint8_t)' ']) {
+        TTfp::buildTables();
     }
 }
 
@@ -62,42 +87,31 @@ void TTfp::assertCurrent(char ch) {
 }
 
 
-// Skip whitespace
+// Skip to the start of the next line
 void TTfp::skipLine(void) {
-    do {
-        if(this->current() == '\n') {
-            this->advance();
-            return;
-        } else {
-            this->advance();
-        }
-    } while(this->current() != EOF);
+    const char *start = &this->text[0] + this->position;
+    const char *newline = (const char *)memchr(start, '\n', this->text.size() - this->position);
+    this->position = newline ? newline - &this->text[0] + 1 : this->text.size();
 }
 
 
-// Skip over chars found in a certain string
-void TTfp::skip(string chars) {
-    do {
-        if(chars.find(this->current()) != string::npos) {
-            this->advance();
-        } else {
-            return;
-        }
-    } while(this->current() != EOF);
+// Skip over chars of the given classes
+void TTfp::skip(uint8_t classes) {
+    while(this->position < this->text.size() && TTfp::isClass(this->text[this->position], classes)) {
+        this->position++;
+    }
 }
 
 
-// Get a sequence of characters from a certain subset of characters
-string TTfp::get(string chars) {
-    string s = "";
-    while(chars.find(this->current()) != string::npos) {
-        s += this->current();
-        this->advance();
-    }
-    return s;
+// Get a sequence of characters of the given classes
+string TTfp::get(uint8_t classes) {
+    uint32_t start = this->position;
+    this->skip(classes);
+    return string(&this->text[0] + start, this->position - start);
 }
 
 
+
 // Get bit pattern represented by number with arbitrary radix
 uint32_t TTfp::getNumber(uint32_t radix) {
 
@@ -107,59 +121,74 @@ uint32_t TTfp::getNumber(uint32_t radix) {
     }
 
     // Skip whitespace
-    this->skip(whiteSpaceChars);
+    this->skip(TTFP_CHAR_WHITESPACE);
+
+    // Accumulate digits, anything that is not a digit has a value above every radix
+    uint32_t value = 0;
+    while(this->position < this->text.size() && TTfp::isClass(this->text[this->position], TTFP_CHAR_NUMBER)) {
+        uint8_t digit = digitValue[(uint8_t)this->text[this->position]];
+        if(digit >= radix) {
+            string ch = ""; ch += this->text[this->position];
+            throw(truthTableParseException("'" + ch + "' outside radix bounds."));
+        }
+        value = value * radix + digit;
+        this->position++;
+    }
 
-    // Get number string
-    string text = this->get(TTfp::numberChars);
+    // Return the computed output
+    return value;
+}
 
-    // build a list of characters accepted at the specified radix
-    string radixChars = "";
-    for(unsigned i = 0; i < radix; i++) {
-        radixChars += numberChars[i];
+
+// Get a number that may contain don't care digits, each covering the bits of one digit
+// Digits left off the front are zeros and are cared about
+uint32_t TTfp::getMaskedNumber(uint32_t radix, uint32_t& careMask) {
+
+    // Make sure radix is apropriate
+    if(radix < 2 || radix > 16) {
+        throw(truthTableParseException("Supported radix values: 2 - 16."));
     }
 
-    // Iterate
+    // Skip whitespace
+    this->skip(TTFP_CHAR_WHITESPACE);
+
+    // Accumulate the value, don't care digits are zeros in the value and set in the mask
     uint32_t value = 0;
-    for(unsigned i = 0; i < text.length(); i++) {
-        if(radixChars.find(text[i]) == string::npos) {
-            string ch = ""; ch += text[i];
-            throw(truthTableParseException("'" + ch + "' outside radix bounds."));
-        }
-        switch(text[i]) {
-            case '0': value *= radix; break;
-            case '1': value *= radix; value += 1; break;
-            case '2': value *= radix; value += 2; break;
-            case '3': value *= radix; value += 3; break;
-            case '4': value *= radix; value += 4; break;
-            case '5': value *= radix; value += 5; break;
-            case '6': value *= radix; value += 6; break;
-            case '7': value *= radix; value += 7; break;
-            case '8': value *= radix; value += 8; break;
-            case '9': value *= radix; value += 9; break;
-            case 'a': case 'A': value *= radix; value += 10; break;
-            case 'b': case 'B': value *= radix; value += 11; break;
-            case 'c': case 'C': value *= radix; value += 12; break;
-            case 'd': case 'D': value *= radix; value += 13; break;
-            case 'e': case 'E': value *= radix; value += 14; break;
-            case 'f': case 'F': value *= radix; value += 15; break;
-            default: return value;
+    uint32_t dontCare = 0;
+    while(this->position < this->text.size() && TTfp::isClass(this->text[this->position], TTFP_CHAR_NUMBER | TTFP_CHAR_DONT_CARE)) {
+        char ch = this->text[this->position];
+        if(TTfp::isClass(ch, TTFP_CHAR_DONT_CARE)) {
+            if(radix & (radix - 1)) {
+                throw(truthTableParseException("Don't care digits need a power of two radix."));
+            }
+            value = value * radix;
+            dontCare = dontCare * radix + radix - 1;
+        } else {
+            uint8_t digit = digitValue[(uint8_t)ch];
+            if(digit >= radix) {
+                string str = ""; str += ch;
+                throw(truthTableParseException("'" + str + "' outside radix bounds."));
+            }
+            value = value * radix + digit;
+            dontCare = dontCare * radix;
         }
+        this->position++;
     }
 
-    // Return the computed output
+    careMask = ~dontCare;
     return value;
 }
 
 
 // Parse individual pattern
-pair<uint32_t, uint32_t> TTfp::getPattern(uint32_t radix) {
+pair<uint32_t, uint32_t> TTfp::getPattern(uint32_t radix, uint32_t& careMask) {
     uint32_t inputBitPattern, outputBitPattern;
 
     // Skip leading whitespace
-    this->skip(whiteSpaceChars);
+    this->skip(TTFP_CHAR_WHITESPACE);
 
     // Start by reading a number at the given radix
-    if(numberChars.find(this->current()) != string::npos) {
+    if(TTfp::isClass(this->current(), TTFP_CHAR_NUMBER)) {
         inputBitPattern = this->getNumber(radix);
     } else {
         stringstream ss;
@@ -169,14 +198,14 @@ pair<uint32_t, uint32_t> TTfp::getPattern(uint32_t radix) {
     }
 
     // Skip more whitespace, look for divider
-    this->skip(whiteSpaceChars);
+    this->skip(TTFP_CHAR_WHITESPACE);
     this->assertCurrent(':');
     this->advance();
-    this->skip(whiteSpaceChars);
+    this->skip(TTFP_CHAR_WHITESPACE);
 
-    // Start by reading a number at the given radix
-    if(numberChars.find(this->current()) != string::npos) {
-        outputBitPattern = this->getNumber(radix);
+    // Outputs may have don't care digits
+    if(TTfp::isClass(this->current(), TTFP_CHAR_NUMBER | TTFP_CHAR_DONT_CARE)) {
+        outputBitPattern = this->getMaskedNumber(radix, careMask);
     } else {
         stringstream ss;
         ss << "Unexpected '" << this->current();
@@ -190,14 +219,16 @@ pair<uint32_t, uint32_t> TTfp::getPattern(uint32_t radix) {
 
 
 // Parse list of patterns
-void TTfp::getPatternList(vector<pair<uint32_t, uint32_t>>& patternList, uint32_t radix) {
+void TTfp::getPatternList(vector<pair<uint32_t, uint32_t>>& patternList, vector<uint32_t>& careMasks, uint32_t radix) {
 
     do {
         // Parse a pattern
-        patternList.push_back(this->getPattern(radix));
+        uint32_t careMask;
+        patternList.push_back(this->getPattern(radix, careMask));
+        careMasks.push_back(careMask);
 
         // Skip trailing whitespace
-        this->skip(whiteSpaceChars);
+        this->skip(TTFP_CHAR_WHITESPACE);
 
         // Check for either comma or semicolon
         if(this->current() == ';') {
@@ -216,30 +247,168 @@ void TTfp::getPatternList(vector<pair<uint32_t, uint32_t>>& patternList, uint32_
 }
 
 
-// Generate line string for debugging
+// Generate line string for debugging, counting lines up to the current position
 string TTfp::lineString(void) {
+    uint32_t end = min((uint32_t)this->text.size(), this->position);
+    uint32_t line = 1;
+    uint32_t lineStart = 0;
+    for(uint32_t i = 0; i < end; i++) {
+        if(this->text[i] == '\n') {
+            line++;
+            lineStart = i + 1;
+        }
+    }
     stringstream ss;
-    ss << "[Line " << this->line << ", col " << this->column << "]";
+    ss << "[Line " << line << ", col " << end - lineStart << "]";
     return ss.str();
 }
 
 
 
+//========[PATTERN INDEX]========================================================================//
+
+
+// Smallest number of sparse slots
+#define PATTERN_INDEX_MIN_SLOTS 16
+
+
+// Size for the expected number of patterns, dropping anything held
+void patternIndex::reset(uint32_t inputCount, uint32_t expectedCount) {
+    this->release();
+
+    // Dense when at least half of the possible inputs are expected
+    uint64_t inputSpace = (uint64_t)0x01 << inputCount;
+    this->dense = inputCount <= PATTERN_INDEX_DENSE_MAX_INPUTS && inputSpace <= 2 * (uint64_t)expectedCount;
+    if(this->dense) {
+        this->seen.assign((inputSpace + 63) / 64, 0);
+        this->values.resize(inputSpace);
+        this->rows.resize(inputSpace);
+    } else {
+        uint32_t slotCount = PATTERN_INDEX_MIN_SLOTS;
+        while(slotCount < 2 * (uint64_t)expectedCount) slotCount <<= 1;
+        this->resizeSlots(slotCount);
+    }
+}
+
+
+// Rehash into a new number of sparse slots, slot count is a power of two
+void patternIndex::resizeSlots(uint32_t slotCount) {
+    vector<uint64_t> oldSeen(slotCount / 64 + 1, 0);
+    vector<uint32_t> oldKeys(slotCount);
+    vector<uint64_t> oldValues(slotCount);
+    vector<uint32_t> oldRows(slotCount);
+    oldSeen.swap(this->seen);
+    oldKeys.swap(this->keys);
+    oldValues.swap(this->values);
+    oldRows.swap(this->rows);
+    this->slotMask = slotCount - 1;
+    this->slotBits = __builtin_ctz(slotCount);
+    this->count = 0;
+
+    // Reinsert whatever was held
+    uint32_t slot;
+    for(unsigned i = 0; i < oldKeys.size(); i++) {
+        if(oldSeen[i / 64] & ((uint64_t)0x01 << (i % 64))) {
+            this->insert(oldKeys[i], oldValues[i], oldRows[i], slot);
+        }
+    }
+}
+
+
+// Add a pattern held at a table row, if the input is already held returns false with its slot
+bool patternIndex::insert(uint32_t iPattern, uint64_t value, uint32_t row, uint32_t& slot) {
+
+    // Dense, the input pattern is the slot
+    if(this->dense) {
+        uint64_t bit = (uint64_t)0x01 << (iPattern % 64);
+        slot = iPattern;
+        if(this->seen[iPattern / 64] & bit) {
+            return false;
+        }
+        this->seen[iPattern / 64] |= bit;
+        this->values[iPattern] = value;
+        this->rows[iPattern] = row;
+        this->count++;
+        return true;
+    }
+
+    // Sparse, linear probe from a multiplicative hash of the input, the high bits of the
+    // product depend on every bit of the input where the low bits only see the low input bits
+    slot = (iPattern * 0x9e3779b1u) >> (32 - this->slotBits);
+    while(this->seen[slot / 64] & ((uint64_t)0x01 << (slot % 64))) {
+        if(this->keys[slot] == iPattern) {
+            return false;
+        }
+        slot = (slot + 1) & this->slotMask;
+    }
+    this->seen[slot / 64] |= (uint64_t)0x01 << (slot % 64);
+    this->keys[slot] = iPattern;
+    this->values[slot] = value;
+    this->rows[slot] = row;
+    this->count++;
+
+    // Keep the load factor at or below a half
+    if(2 * (uint64_t)this->count > (uint64_t)this->slotMask + 1) {
+        this->resizeSlots(2 * (this->slotMask + 1));
+    }
+    return true;
+}
+
+
+// Free the storage
+void patternIndex::release(void) {
+    vector<uint64_t>().swap(this->seen);
+    vector<uint32_t>().swap(this->keys);
+    vector<uint64_t>().swap(this->values);
+    vector<uint32_t>().swap(this->rows);
+    this->count = 0;
+    this->slotMask = 0;
+    this->slotBits = 0;
+}
+
+
+
+//========[BIT MATRIX TRANSPOSE]=================================================================//
+
+
+// Transposes a 64x64 bit matrix in place, element (r, c) is bit 63 - c of row r
+// Swaps progressively smaller off diagonal blocks, 6 passes of 32 word operations
+// with no data dependent branches, so the inner loop vectorises
+static void transposeBitMatrix(uint64_t *m) {
+    uint64_t mask = 0x00000000ffffffffULL;
+    for(unsigned j = 32; j != 0; j >>= 1, mask ^= mask << j) {
+        for(unsigned k = 0; k < 64; k = ((k | j) + 1) & ~j) {
+            uint64_t t = (m[k] ^ (m[k | j] >> j)) & mask;
+            m[k] ^= t;
+            m[k | j] ^= t << j;
+        }
+    }
+}
+
+
+
 //========[PUBLIC INTERFACE METHODS]=============================================================//
 
 
 // Constructor from file
 truthTable::truthTable(string path) {
 
+    // Binary files need no parsing
+    if(truthTable::isBinaryFile(path)) {
+        this->readBinaryFile(path);
+        return;
+    }
+
     // Parsing variables
     uint32_t radix = 0;
     uint32_t inputCount = 0;
     uint32_t outputCount = 0;
     vector<pair<uint32_t, uint32_t>> patterns;
+    vector<uint32_t> careMasks;
 
     // Create a specialised parser/function pointer and skip leading whitespace
     TTfp fp(path);
-    fp.skip(TTfp::whiteSpaceChars);
+    fp.skip(TTFP_CHAR_WHITESPACE);
 
     // Parse the file and populate the table
     do {
@@ -248,14 +417,14 @@ truthTable::truthTable(string path) {
             fp.skipLine();
 
         // Parse identifiers
-        } else if(TTfp::nameChars.find(fp.current()) != string::npos) {
-            string ident = fp.get(TTfp::nameChars);
+        } else if(TTfp::isClass(fp.current(), TTFP_CHAR_NAME)) {
+            string ident = fp.get(TTFP_CHAR_NAME);
             if(ident == "inputCount" || ident == "iCount") {
                 if(inputCount) {
                     throw(truthTableParseException("Input count already specified."));
                 } else {
                     inputCount = fp.getNumber(10);
-                    fp.skip(TTfp::whiteSpaceChars);
+                    fp.skip(TTFP_CHAR_WHITESPACE);
                     fp.assertCurrent(';');
                     fp.advance();
                 }
@@ -265,20 +434,20 @@ truthTable::truthTable(string path) {
                     throw(truthTableParseException("Output count already specified."));
                 } else {
                     outputCount = fp.getNumber(10);
-                    fp.skip(TTfp::whiteSpaceChars);
+                    fp.skip(TTFP_CHAR_WHITESPACE);
                     fp.assertCurrent(';');
                     fp.advance();
                 }
 
             } else if(ident == "radix") {
                 radix = fp.getNumber(10);
-                fp.skip(TTfp::whiteSpaceChars);
+                fp.skip(TTFP_CHAR_WHITESPACE);
                 fp.assertCurrent(';');
                 fp.advance();
 
             } else if(ident == "pattern") {
                 if(radix) {
-                    fp.getPatternList(patterns, radix);
+                    fp.getPatternList(patterns, careMasks, radix);
                 } else throw(truthTableParseException("Radix not specified."));
 
             } else {
@@ -293,7 +462,7 @@ truthTable::truthTable(string path) {
         }
 
         // Skip trailing whitespace
-        fp.skip(TTfp::whiteSpaceChars);
+        fp.skip(TTFP_CHAR_WHITESPACE);
 
     } while(fp.current() != EOF);
 
@@ -304,8 +473,87 @@ truthTable::truthTable(string path) {
 
     // Initialise the table data structure and add all discovered patterns
     *this = truthTable(inputCount, outputCount);
-    for(unsigned i = 0; i < patterns.size(); i++) {
-        addPattern(patterns[i].first, patterns[i].second);
+    this->addPatterns(patterns, careMasks);
+    this->releaseIndex();
+}
+
+
+// Constructor from file, the file is parsed by the root process only and the
+// table is broadcast to the rest as raw bitmaps, every process throws if the parse fails
+truthTable::truthTable(string path, int32_t root) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    // Binary files are mapped by every process, sharing the page cache
+    if(truthTable::isBinaryFile(path)) {
+        this->readBinaryFile(path);
+        return;
+    }
+
+    // Parse on the root, holding on to any failure until the other processes know of it
+    exception_ptr failure;
+    if(rank == root) {
+        try {
+            *this = truthTable(path);
+        } catch(...) {
+            failure = current_exception();
+        }
+    }
+
+    // Broadcast the shape of the table and the number of care columns, or the failure
+    uint32_t shape[5] = {0, 0, 0, 0, 0};
+    if(rank == root && failure) {
+        shape[4] = 1;
+    } else if(rank == root) {
+        shape[0] = this->getInputCount();
+        shape[1] = this->getOutputCount();
+        shape[2] = this->getPatternCount();
+        shape[3] = this->cares.size();
+    }
+    MPI_Bcast(shape, 5, MPI_UNSIGNED, root, MPI_COMM_WORLD);
+
+    // Every process throws together if the root couldn't parse the file
+    if(shape[4]) {
+        if(rank == root) {
+            rethrow_exception(failure);
+        }
+        throw(truthTableParseException("Truth table '" + path + "' could not be read by the root process."));
+    }
+
+    // Pack every column, padded to whole lanes, into a single buffer sized in size_t
+    size_t columnCount = (size_t)shape[0] + shape[1] + shape[3];
+    size_t laneBitmapCount = (((size_t)shape[2] + 63) / 64 + BITVECTOR_LANE_WORDS - 1) / BITVECTOR_LANE_WORDS * BITVECTOR_LANE_WORDS;
+    vector<uint64_t> bitmaps(columnCount * laneBitmapCount);
+    if(rank == root) {
+        for(size_t i = 0; i < columnCount; i++) {
+            const uint64_t *column;
+            if(i < shape[0]) column = this->getInputBitmaps(i);
+            else if(i < shape[0] + shape[1]) column = this->getOutputBitmaps(i - shape[0]);
+            else column = this->getCareBitmaps(i - shape[0] - shape[1]);
+            std::copy(column, column + laneBitmapCount, &bitmaps[i * laneBitmapCount]);
+        }
+    }
+
+    // Broadcast the bitmaps in chunks, MPI counts are int
+    for(size_t offset = 0; offset < bitmaps.size(); offset += INT_MAX) {
+        int count = (int)min(bitmaps.size() - offset, (size_t)INT_MAX);
+        MPI_Bcast(&bitmaps[offset], count, MPI_UINT64_T, root, MPI_COMM_WORLD);
+    }
+
+    // Rebuild the table from the bitmaps
+    if(rank != root) {
+        *this = truthTable(shape[0], shape[1]);
+        for(size_t i = 0; i < shape[0]; i++) {
+            this->inputs[i].assign(shape[2], &bitmaps[i * laneBitmapCount]);
+        }
+        for(size_t i = 0; i < shape[1]; i++) {
+            this->outputs[i].assign(shape[2], &bitmaps[(shape[0] + i) * laneBitmapCount]);
+        }
+        this->cares.resize(shape[3]);
+        for(size_t i = 0; i < shape[3]; i++) {
+            this->cares[i].assign(shape[2], &bitmaps[(shape[0] + shape[1] + i) * laneBitmapCount]);
+        }
+        this->updateBitmapMasks();
     }
 }
 
@@ -327,6 +575,14 @@ truthTable::truthTable(uint32_t inputCount, uint32_t outputCount) {
     this->inputs.clear();
     this->outputs.clear();
 
+    // Held in memory until loaded from a mapped file or given a kernel
+    this->mappedColumns = NULL;
+    this->mappedPatternCount = 0;
+    this->residentBudget = 0;
+    this->residentThreadCount = 1;
+    this->kernelWidth = 0;
+    this->counterInputs = false;
+
     // Reserve space for inputs
     this->inputs.reserve(inputCount);
     for(unsigned i = 0; i < inputCount; i++) {
@@ -344,18 +600,20 @@ truthTable::truthTable(uint32_t inputCount, uint32_t outputCount) {
 // Returns true of the pattern is a valid optimisation target
 void truthTable::assertValid(void) {
 
-    // First, get length of first input vector
-    uint32_t bitPatternCount = this->inputs[0].getLength();
+    // First, get the pattern count
+    uint32_t bitPatternCount = this->getPatternCount();
 
-    // Compare it to other input vectors
-    for(unsigned i = 1; i < this->inputs.size(); i++) {
+    // Compare it to other input vectors, mapped columns were checked when loaded
+    // and procedural tables have no stored columns
+    bool held = !this->mapping && !this->kernel;
+    for(unsigned i = 1; i < this->inputs.size() && held; i++) {
         if(this->inputs[i].getLength() != bitPatternCount) {
             throw(logic_error("Truth table consistency fail, input vector length mismatch."));
         }
     }
 
     // Compare it to output vectors
-    for(unsigned i = 0; i < this->outputs.size(); i++) {
+    for(unsigned i = 0; i < this->outputs.size() && held; i++) {
         if(this->outputs[i].getLength() != bitPatternCount) {
             throw(logic_error("Truth table consistency fail, output vector length mismatch."));
         }
@@ -381,20 +639,43 @@ void truthTable::assertValid(void) {
 // Add a pattern to the target
 // LSB = input 0, and so forth.
 void truthTable::addPattern(uint32_t iPattern, uint32_t oPattern) {
+    this->addPattern(iPattern, oPattern, ~((uint32_t)0));
+}
+
+
+// Add a pattern with don't care outputs, output bits outside the care mask are stored as zeros
+void truthTable::addPattern(uint32_t iPattern, uint32_t oPattern, uint32_t careMask) {
+    this->materialise();
 
     // Mask the input and output patterns
+    uint32_t outputMask = (((uint32_t)0x01) << this->outputs.size()) - 1;
     uint32_t iPatternMasked = iPattern & ((((uint32_t)0x01) << this->inputs.size()) - 1);
-    uint32_t oPatternMasked = oPattern & ((((uint32_t)0x01) << this->outputs.size()) - 1);
+    uint32_t careMasked = careMask & outputMask;
+    uint32_t oPatternMasked = oPattern & careMasked;
 
-    // Check whether input pattern has already been specified
-    if(this->patternMap.find(iPatternMasked) != this->patternMap.end()) {
-        if(this->patternMap[iPatternMasked] != oPatternMasked) {
-            throw(logic_error("Truth table logic fail, conflicting pattern submitted."));
-        } else {
-            cout << "Warning, duplicate pattern [";
-            cout << iPattern << ":" << oPattern << "], definition ignored\n";
-            return;
-        }
+    // Patterns that care about no outputs can never cost a bit error
+    if(!careMasked) {
+        return;
+    }
+
+    // Check whether input pattern has already been specified, a definition caring about
+    // more outputs is merged into the existing row
+    this->buildIndex(1);
+    uint32_t row = this->getPatternCount();
+    patternIndexResult_t indexed = this->indexPattern(iPatternMasked, oPatternMasked, careMasked, row);
+    if(indexed == PATTERN_DUPLICATE) {
+        cout << "Warning, duplicate pattern [";
+        cout << iPattern << ":" << oPattern << "], definition ignored\n";
+        return;
+    }
+    if(indexed == PATTERN_MERGED) {
+        this->mergePattern(row, oPatternMasked, careMasked);
+        return;
+    }
+
+    // Care columns are only kept once a pattern has don't cares
+    if(careMasked != outputMask) {
+        this->addCareColumns();
     }
 
     // Add pattern to input vectors
@@ -415,8 +696,292 @@ void truthTable::addPattern(uint32_t iPattern, uint32_t oPattern) {
         }
     }
 
-    // Add new pattern to pattern map
-    this->patternMap.insert(make_pair(iPatternMasked, oPatternMasked));
+    // Add to care vectors
+    for(unsigned i = 0; i < this->cares.size(); i++) {
+        this->cares[i].appendBit((careMasked >> i) & 0x01);
+    }
+
+    // Keep the bitmap masks in step with the new final bitmap
+    uint32_t last = this->getBitmapCount() - 1;
+    if(this->bitmapMasks.size() < this->getLaneBitmapCount()) {
+        this->bitmapMasks.resize(this->getLaneBitmapCount(), 0);
+    }
+    if(last) this->bitmapMasks[last - 1] = ~((uint64_t)0);
+    this->bitmapMasks[last] = this->inputs[0].bitmapMask(last);
+    this->updateCounterInputs();
+}
+
+
+// Start care columns, every existing pattern cares about every output
+void truthTable::addCareColumns(void) {
+    if(!this->cares.empty()) {
+        return;
+    }
+    this->cares.resize(this->getOutputCount());
+    this->bitmapMasks.resize(this->getLaneBitmapCount(), 0);
+    for(unsigned i = 0; i < this->cares.size(); i++) {
+        this->cares[i].assign(this->getPatternCount(), this->bitmapMasks.data());
+    }
+}
+
+
+// Index the existing patterns ahead of adding more, the index is sized from the
+// patterns expected so a bulk load picks the dense index when it fills the input space
+void truthTable::buildIndex(uint32_t incomingCount) {
+    if(!this->index.isEmpty()) {
+        return;
+    }
+    uint32_t patternCount = this->getPatternCount();
+    this->index.reset(this->getInputCount(), patternCount + incomingCount);
+    uint32_t slot;
+    for(unsigned i = 0; i < patternCount; i++) {
+        pair<uint32_t, uint32_t> pattern = this->getPattern(i);
+        this->index.insert(pattern.first, pattern.second | ((uint64_t)this->getCareMask(i) << 32), i, slot);
+    }
+}
+
+
+// Index a masked pattern to be held at row, throws on a conflict. Patterns only conflict on
+// outputs that both of them care about, a repeated input caring about outputs the held
+// definition didn't is merged into it, returning the merged outputs and care mask and the
+// row holding them
+patternIndexResult_t truthTable::indexPattern(uint32_t iPattern, uint32_t& oPattern, uint32_t& careMask, uint32_t& row) {
+    uint32_t slot;
+    if(this->index.insert(iPattern, oPattern | ((uint64_t)careMask << 32), row, slot)) {
+        return PATTERN_NEW;
+    }
+    uint64_t existing = this->index.getValue(slot);
+    uint32_t existingOutput = (uint32_t)existing;
+    uint32_t existingCare = (uint32_t)(existing >> 32);
+    if((oPattern ^ existingOutput) & careMask & existingCare) {
+        throw(logic_error("Truth table logic fail, conflicting pattern submitted."));
+    }
+    if(!(careMask & ~existingCare)) {
+        return PATTERN_DUPLICATE;
+    }
+    oPattern = existingOutput | (oPattern & ~existingCare);
+    careMask |= existingCare;
+    row = this->index.getRow(slot);
+    this->index.setValue(slot, oPattern | ((uint64_t)careMask << 32));
+    return PATTERN_MERGED;
+}
+
+
+// Rewrite the outputs and cares of a row already in the table with a merged definition,
+// the row has don't cares so the care columns exist
+void truthTable::mergePattern(uint32_t row, uint32_t oPattern, uint32_t careMask) {
+    for(unsigned i = 0; i < this->getOutputCount(); i++) {
+        this->outputs[i].setBit(row, (oPattern >> i) & 0x01);
+    }
+    for(unsigned i = 0; i < this->cares.size(); i++) {
+        this->cares[i].setBit(row, (careMask >> i) & 0x01);
+    }
+}
+
+
+// Free the pattern index, it is rebuilt from the bitmaps if more patterns are added
+void truthTable::releaseIndex(void) {
+    this->index.release();
+}
+
+
+// Copy a mapped or procedural table into the bit vectors so that it can be modified
+void truthTable::materialise(void) {
+
+    // Procedural tables are generated a whole column at a time
+    if(this->kernel) {
+        uint32_t patternCount = this->getPatternCount();
+        uint32_t bitmapCount = this->getBitmapCount();
+        uint32_t laneBitmapCount = this->getLaneBitmapCount();
+        vector<uint64_t> columns((size_t)this->getOutputCount() * laneBitmapCount, 0);
+        this->generateOutputBitmaps(0, bitmapCount, columns.data(), laneBitmapCount);
+        for(unsigned i = 0; i < this->outputs.size(); i++) {
+            this->outputs[i].assign(patternCount, &columns[(size_t)i * laneBitmapCount]);
+        }
+        for(unsigned i = 0; i < this->inputs.size(); i++) {
+            for(unsigned k = 0; k < bitmapCount; k++) {
+                columns[k] = counterBitmap(i, k) & this->getBitmapMask(k);
+            }
+            this->inputs[i].assign(patternCount, columns.data());
+        }
+        this->kernel.reset();
+        this->updateBitmapMasks();
+        return;
+    }
+
+    if(!this->mapping) {
+        return;
+    }
+    uint32_t patternCount = this->mappedPatternCount;
+    for(unsigned i = 0; i < this->inputs.size(); i++) {
+        this->inputs[i].assign(patternCount, this->getInputBitmaps(i));
+    }
+    for(unsigned i = 0; i < this->outputs.size(); i++) {
+        this->outputs[i].assign(patternCount, this->getOutputBitmaps(i));
+    }
+    for(unsigned i = 0; i < this->cares.size(); i++) {
+        this->cares[i].assign(patternCount, this->getCareBitmaps(i));
+    }
+    this->mapping.reset();
+    this->mappedColumns = NULL;
+    this->updateBitmapMasks();
+}
+
+
+// Rebuild the valid bit masks for every bitmap
+void truthTable::updateBitmapMasks(void) {
+    this->bitmapMasks.assign(this->getLaneBitmapCount(), 0);
+    for(unsigned i = 0; i < this->getBitmapCount(); i++) {
+        this->bitmapMasks[i] = this->inputs[0].bitmapMask(i);
+    }
+    this->updateCounterInputs();
+}
+
+
+// Check whether the table holds every input pattern in counting order, as generated tables
+// do, so evaluators can make the input columns rather than read them. Only complete
+// tables are compared against the counter bitmaps
+void truthTable::updateCounterInputs(void) {
+    uint32_t inputCount = this->getInputCount();
+    this->counterInputs = inputCount <= TRUTH_TABLE_KERNEL_MAX_INPUTS &&
+                          this->getPatternCount() == ((uint32_t)0x01) << inputCount;
+    for(unsigned i = 0; i < inputCount && this->counterInputs; i++) {
+        const uint64_t *column = this->inputs[i].getBitmapData();
+        for(unsigned k = 0; k < this->getBitmapCount() && this->counterInputs; k++) {
+            this->counterInputs = column[k] == (counterBitmap(i, k) & this->bitmapMasks[k]);
+        }
+    }
+}
+
+
+// Add patterns in bulk, the columns are built a bitmap at a time rather than a bit at a time
+void truthTable::addPatterns(vector<pair<uint32_t, uint32_t>> const& patterns, vector<uint32_t> const& careMasks) {
+    this->materialise();
+    uint32_t inputCount = this->getInputCount();
+    uint32_t outputCount = this->getOutputCount();
+    uint32_t inputMask = (((uint32_t)0x01) << inputCount) - 1;
+    uint32_t outputMask = (((uint32_t)0x01) << outputCount) - 1;
+
+    // Keep the patterns not seen before, dropping any that care about no outputs
+    this->buildIndex(patterns.size());
+    uint32_t first = this->getPatternCount();
+    vector<pair<uint32_t, uint32_t>> accepted;
+    vector<uint32_t> acceptedCares;
+    accepted.reserve(patterns.size());
+    acceptedCares.reserve(patterns.size());
+    bool partial = this->hasDontCares();
+    for(unsigned i = 0; i < patterns.size(); i++) {
+        uint32_t careMasked = careMasks.empty() ? outputMask : careMasks[i] & outputMask;
+        uint32_t iPatternMasked = patterns[i].first & inputMask;
+        uint32_t oPatternMasked = patterns[i].second & careMasked;
+        if(!careMasked) {
+            continue;
+        }
+        uint32_t row = first + accepted.size();
+        patternIndexResult_t indexed = this->indexPattern(iPatternMasked, oPatternMasked, careMasked, row);
+        if(indexed == PATTERN_DUPLICATE) {
+            cout << "Warning, duplicate pattern [";
+            cout << patterns[i].first << ":" << patterns[i].second << "], definition ignored\n";
+            continue;
+        }
+
+        // Merged definitions are written back to the row holding the input
+        if(indexed == PATTERN_MERGED) {
+            if(row < first) {
+                this->mergePattern(row, oPatternMasked, careMasked);
+            } else {
+                accepted[row - first].second = oPatternMasked;
+                acceptedCares[row - first] = careMasked;
+            }
+            continue;
+        }
+        accepted.push_back(make_pair(iPatternMasked, oPatternMasked));
+        acceptedCares.push_back(careMasked);
+        partial |= careMasked != outputMask;
+    }
+
+    // Care columns follow the outputs once any pattern has don't cares
+    if(partial) {
+        this->addCareColumns();
+    }
+    uint32_t careCount = this->cares.size();
+    uint32_t columnCount = inputCount + outputCount + careCount;
+
+    // Lane padded storage for every column, starting from the existing patterns
+    uint32_t length = first + accepted.size();
+    uint32_t bitmapCount = (length + 63) / 64;
+    uint32_t laneBitmapCount = (bitmapCount + BITVECTOR_LANE_WORDS - 1) / BITVECTOR_LANE_WORDS * BITVECTOR_LANE_WORDS;
+    uint32_t existingBitmapCount = (first + 63) / 64;
+    vector<uint64_t> columns(columnCount * laneBitmapCount, 0);
+    for(unsigned i = 0; i < columnCount; i++) {
+        const uint64_t *column;
+        if(i < inputCount) column = this->getInputBitmaps(i);
+        else if(i < inputCount + outputCount) column = this->getOutputBitmaps(i - inputCount);
+        else column = this->getCareBitmaps(i - inputCount - outputCount);
+        std::copy(column, column + existingBitmapCount, &columns[i * laneBitmapCount]);
+    }
+    uint64_t *careColumns = &columns[(inputCount + outputCount) * laneBitmapCount];
+
+    // Patterns up to the next whole bitmap are scattered a bit at a time
+    uint32_t k = 0;
+    for(; k < accepted.size() && (first + k) % 64; k++) {
+        uint32_t bitIndex = first + k;
+        uint64_t *word = &columns[bitIndex / 64];
+        uint64_t bit = (uint64_t)0x01 << (63 - (bitIndex % 64));
+        for(unsigned i = 0; i < inputCount; i++) {
+            if(accepted[k].first & (0x01 << i)) word[i * laneBitmapCount] |= bit;
+        }
+        for(unsigned i = 0; i < outputCount; i++) {
+            if(accepted[k].second & (0x01 << i)) word[(inputCount + i) * laneBitmapCount] |= bit;
+        }
+        for(unsigned i = 0; i < careCount; i++) {
+            if(acceptedCares[k] & (0x01 << i)) careColumns[i * laneBitmapCount + bitIndex / 64] |= bit;
+        }
+    }
+
+    // The rest go 64 at a time through a bit matrix transpose, pattern words hold the
+    // inputs in the low half and outputs in the high half, and come out as one
+    // bitmap per column with column c in row 63 - c
+    uint64_t block[64];
+    for(; k < accepted.size(); k += 64) {
+        uint32_t blockCount = min((uint32_t)accepted.size() - k, (uint32_t)64);
+        for(unsigned j = 0; j < 64; j++) {
+            block[j] = j < blockCount ? accepted[k + j].first | ((uint64_t)accepted[k + j].second << 32) : 0;
+        }
+        transposeBitMatrix(block);
+
+        // Write the column bitmaps
+        uint64_t *word = &columns[(first + k) / 64];
+        for(unsigned i = 0; i < inputCount; i++) {
+            word[i * laneBitmapCount] = block[63 - i];
+        }
+        for(unsigned i = 0; i < outputCount; i++) {
+            word[(inputCount + i) * laneBitmapCount] = block[31 - i];
+        }
+
+        // Care masks take a second transpose, in the high half like the outputs
+        if(careCount) {
+            for(unsigned j = 0; j < 64; j++) {
+                block[j] = j < blockCount ? (uint64_t)acceptedCares[k + j] << 32 : 0;
+            }
+            transposeBitMatrix(block);
+            for(unsigned i = 0; i < careCount; i++) {
+                careColumns[i * laneBitmapCount + (first + k) / 64] = block[31 - i];
+            }
+        }
+    }
+
+    // Hand the columns over to the bit vectors
+    for(unsigned i = 0; i < inputCount; i++) {
+        this->inputs[i].assign(length, &columns[i * laneBitmapCount]);
+    }
+    for(unsigned i = 0; i < outputCount; i++) {
+        this->outputs[i].assign(length, &columns[(inputCount + i) * laneBitmapCount]);
+    }
+    for(unsigned i = 0; i < careCount; i++) {
+        this->cares[i].assign(length, &careColumns[i * laneBitmapCount]);
+    }
+    this->updateBitmapMasks();
 }
 
 
@@ -426,21 +991,34 @@ void truthTable::addPattern(pair<uint32_t, uint32_t> pattern) {
 }
 
 
-// Get a pattern from the
+// Read a bit from a column, bit 0 is the most significant bit of the first bitmap
+static inline bool columnBit(const uint64_t *column, uint32_t index) {
+    return (column[index / 64] >> (63 - (index % 64))) & 0x01;
+}
+
+
+// Get a pattern from the table, don't care output bits read as zeros
 pair<uint32_t, uint32_t> truthTable::getPattern(uint32_t index) {
+    if(index >= this->getPatternCount()) {
+        throw(out_of_range("Truth table pattern index out of range."));
+    }
+    if(this->kernel) {
+        uint32_t outputMask = (uint32_t)((((uint64_t)0x01) << this->getOutputCount()) - 1);
+        return make_pair(index, this->kernel->function(index, this->kernelWidth) & outputMask);
+    }
     uint32_t inputBitmap = 0;
     uint32_t outputBitmap = 0;
 
     // Get input bitmap
     for(unsigned i = 0; i < this->getInputCount(); i++) {
-        if(this->inputs[i].getBit(index)) {
+        if(columnBit(this->getInputBitmaps(i), index)) {
             inputBitmap |= 0x01 << i;
         }
     }
 
     // Get output bitmap
     for(unsigned i = 0; i < this->getOutputCount(); i++) {
-        if(this->outputs[i].getBit(index)) {
+        if(columnBit(this->getOutputBitmaps(i), index)) {
             outputBitmap |= 0x01 << i;
         }
     }
@@ -450,21 +1028,116 @@ pair<uint32_t, uint32_t> truthTable::getPattern(uint32_t index) {
 }
 
 
+// Get the care mask of a pattern, every output is cared about in fully specified tables
+uint32_t truthTable::getCareMask(uint32_t index) {
+    if(this->cares.empty()) {
+        return (((uint32_t)0x01) << this->getOutputCount()) - 1;
+    }
+    uint32_t careMask = 0;
+    for(unsigned i = 0; i < this->cares.size(); i++) {
+        if(columnBit(this->getCareBitmaps(i), index)) {
+            careMask |= 0x01 << i;
+        }
+    }
+    return careMask;
+}
+
+
 // Gets the input bitmap associated with
 uint64_t truthTable::getInputBitmap(uint32_t inputIndex, uint32_t bitmapIndex) {
-    return this->inputs[inputIndex].getBitmap(bitmapIndex);
+    if(this->counterInputs) {
+        return counterBitmap(inputIndex, bitmapIndex) & this->getBitmapMask(bitmapIndex);
+    }
+    return this->getInputBitmaps(inputIndex)[bitmapIndex];
 }
 
 
 // Gets the output bitmap associated with
+// Procedural tables keep the last block of bitmaps generated per thread, keyed to the
+// table and its kernel, the word at a time evaluators walk the bitmaps in order
 uint64_t truthTable::getOutputBitmap(uint32_t outputIndex, uint32_t bitmapIndex) {
-    return this->outputs[outputIndex].getBitmap(bitmapIndex);
+    if(this->kernel) {
+        static thread_local vector<uint64_t> cached;
+        static thread_local const truthTable *cachedTable = NULL;
+        static thread_local const truthTableKernel_t *cachedKernel = NULL;
+        static thread_local uint32_t cachedWidth = 0;
+        static thread_local uint32_t cachedFirst = 0;
+        static thread_local uint32_t cachedCount = 0;
+        if(cachedTable != this || cachedKernel != this->kernel.get() || cachedWidth != this->kernelWidth ||
+           bitmapIndex < cachedFirst || bitmapIndex >= cachedFirst + cachedCount) {
+            uint32_t blockBitmapCount = this->getBlockBitmapCount();
+            cachedFirst = bitmapIndex / blockBitmapCount * blockBitmapCount;
+            cachedCount = min(blockBitmapCount, this->getBitmapCount() - cachedFirst);
+            cached.resize((size_t)this->getOutputCount() * cachedCount);
+            this->generateOutputBitmaps(cachedFirst, cachedCount, cached.data(), cachedCount);
+            cachedTable = this;
+            cachedKernel = this->kernel.get();
+            cachedWidth = this->kernelWidth;
+        }
+        return cached[(size_t)outputIndex * cachedCount + bitmapIndex - cachedFirst];
+    }
+    return this->getOutputBitmaps(outputIndex)[bitmapIndex];
 }
 
 
 // Gets bitmap mask for end bitmaps
 uint64_t truthTable::getBitmapMask(uint32_t bitmapIndex) {
-    return this->inputs[0].bitmapMask(bitmapIndex);
+    uint32_t patternCount = this->getPatternCount();
+    if(bitmapIndex < patternCount / 64) {
+        return ~((uint64_t)0);
+    } else if(bitmapIndex == patternCount / 64 && patternCount % 64) {
+        return ~((uint64_t)0) << (64 - patternCount % 64);
+    }
+    return 0;
+}
+
+
+// Gets the valid bits of an output that are cared about
+uint64_t truthTable::getCareBitmap(uint32_t outputIndex, uint32_t bitmapIndex) {
+    if(this->cares.empty()) {
+        return this->getBitmapMask(bitmapIndex);
+    }
+    return this->getCareBitmaps(outputIndex)[bitmapIndex];
+}
+
+
+// Raw columns, mapped columns are stored inputs first, then outputs, then cares
+// Procedural tables have no columns to point at until they are materialised
+const uint64_t *truthTable::getInputBitmaps(uint32_t inputIndex) {
+    if(this->kernel) {
+        throw(logic_error("Generated truth table columns requested before the table was materialised."));
+    }
+    if(this->mapping) {
+        return this->mappedColumns + (size_t)inputIndex * this->getLaneBitmapCount();
+    }
+    return this->inputs[inputIndex].getBitmapData();
+}
+
+const uint64_t *truthTable::getOutputBitmaps(uint32_t outputIndex) {
+    if(this->kernel) {
+        throw(logic_error("Generated truth table columns requested before the table was materialised."));
+    }
+    if(this->mapping) {
+        return this->mappedColumns + (size_t)(this->getInputCount() + outputIndex) * this->getLaneBitmapCount();
+    }
+    return this->outputs[outputIndex].getBitmapData();
+}
+
+const uint64_t *truthTable::getCareBitmaps(uint32_t outputIndex) {
+    if(this->mapping) {
+        return this->mappedColumns + (size_t)(this->getInputCount() + this->getOutputCount() + outputIndex) * this->getLaneBitmapCount();
+    }
+    return this->cares[outputIndex].getBitmapData();
+}
+
+
+// Bitmap count rounded up to a whole number of 512 bit lanes
+uint32_t truthTable::getLaneBitmapCount(void) {
+    uint32_t count = this->getBitmapCount();
+    if(count % BITVECTOR_LANE_WORDS) {
+        count += BITVECTOR_LANE_WORDS - (count % BITVECTOR_LANE_WORDS);
+    }
+    return count;
 }
 
 
@@ -487,13 +1160,14 @@ void truthTable::writeToFile(string path, uint32_t radix) {
     // Write patterns to file
     for(unsigned i = 0; i < this->getPatternCount(); i++) {
         pair<uint32_t, uint32_t> pattern = this->getPattern(i);
+        uint32_t careMask = this->getCareMask(i);
         fp << "pattern ";
         for(int j = this->getInputCount() - 1; j > -1; j--) {
             if(pattern.first & (0x01 << j)) fp << "1"; else fp << "0";
         }
         fp << ":";
         for(int j = this->getOutputCount() - 1; j > -1; j--) {
-            if(pattern.second & (0x01 << j)) fp << "1"; else fp << "0";
+            if(!(careMask & (0x01 << j))) fp << "x"; else if(pattern.second & (0x01 << j)) fp << "1"; else fp << "0";
         }
         fp << ";\n";
     }
@@ -507,3 +1181,455 @@ void truthTable::writeToFile(string path, uint32_t radix) {
 void truthTable::writeToFile(string path) {
     this->writeToFile(path, 2);
 }
+
+
+// Writes the truth table to a binary file
+// Procedural tables are written from a materialised copy, the table itself stays procedural
+void truthTable::writeBinaryFile(string path) {
+    if(this->kernel) {
+        truthTable copy = *this;
+        copy.materialise();
+        copy.writeBinaryFile(path);
+        return;
+    }
+
+    // Open file for writing
+    ofstream fp(path, ios::binary);
+    if(!fp.is_open()) {
+        throw(runtime_error("Could not open file '" + path + "' for writing."));
+    }
+
+    // Write the header
+    truthTableBinaryHeader_t header;
+    memset(&header, 0, sizeof(header));
+    header.magic = TRUTH_TABLE_BINARY_MAGIC;
+    header.version = TRUTH_TABLE_BINARY_VERSION;
+    header.inputCount = this->getInputCount();
+    header.outputCount = this->getOutputCount();
+    header.patternCount = this->getPatternCount();
+    header.laneBitmapCount = this->getLaneBitmapCount();
+    header.flags = this->cares.empty() ? 0 : TRUTH_TABLE_BINARY_FLAG_CARE;
+    header.flags |= this->counterInputs ? TRUTH_TABLE_BINARY_FLAG_COUNTER : 0;
+    fp.write((const char *)&header, sizeof(header));
+
+    // Write the input, output then care columns
+    for(unsigned i = 0; i < header.inputCount; i++) {
+        fp.write((const char *)this->getInputBitmaps(i), header.laneBitmapCount * sizeof(uint64_t));
+    }
+    for(unsigned i = 0; i < header.outputCount; i++) {
+        fp.write((const char *)this->getOutputBitmaps(i), header.laneBitmapCount * sizeof(uint64_t));
+    }
+    for(unsigned i = 0; i < this->cares.size(); i++) {
+        fp.write((const char *)this->getCareBitmaps(i), header.laneBitmapCount * sizeof(uint64_t));
+    }
+
+    // Close the file
+    fp.close();
+}
+
+
+// Checks the file for the binary truth table magic number
+bool truthTable::isBinaryFile(string path) {
+    ifstream fp(path, ios::binary);
+    uint32_t magic = 0;
+    fp.read((char *)&magic, sizeof(magic));
+    return fp && magic == TRUTH_TABLE_BINARY_MAGIC;
+}
+
+
+// Loads the table from a binary file, the columns are read straight out of the mapping
+// so processes sharing a node share the page cache and pages come and go on demand
+void truthTable::readBinaryFile(string path) {
+
+    // Open and map the file
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0) {
+        throw(runtime_error("Could not open file '" + path + "' for reading."));
+    }
+    struct stat st;
+    if(fstat(fd, &st) < 0) {
+        close(fd);
+        throw(runtime_error("Could not read the size of file '" + path + "'."));
+    }
+    size_t fileSize = st.st_size;
+    void *map = fileSize ? mmap(NULL, fileSize, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if(map == MAP_FAILED) {
+        throw(runtime_error("Could not map file '" + path + "'."));
+    }
+    shared_ptr<truthTableMapping> mapping = make_shared<truthTableMapping>(map, fileSize);
+
+    // Check every header field before anything past the header is read, sizes are
+    // worked in 64 bits as a corrupt header may hold any value
+    const truthTableBinaryHeader_t *header = (const truthTableBinaryHeader_t *)map;
+    const uint64_t *columns = (const uint64_t *)(header + 1);
+    uint32_t careCount = fileSize >= sizeof(truthTableBinaryHeader_t) && (header->flags & TRUTH_TABLE_BINARY_FLAG_CARE) ? header->outputCount : 0;
+    string problem;
+    if(fileSize < sizeof(truthTableBinaryHeader_t)) {
+        problem = "truncated header";
+    } else if(header->magic != TRUTH_TABLE_BINARY_MAGIC) {
+        problem = "not a binary truth table";
+    } else if(header->version != TRUTH_TABLE_BINARY_VERSION) {
+        problem = "unsupported version";
+    } else if(!header->inputCount || !header->outputCount || !header->patternCount) {
+        problem = "empty table";
+    } else if(header->inputCount > TRUTH_TABLE_KERNEL_MAX_INPUTS || header->outputCount > 32) {
+        problem = "more than 31 inputs or 32 outputs";
+    } else if(header->patternCount > ((uint64_t)0x01) << header->inputCount) {
+        problem = "more patterns than input patterns";
+    } else if(header->laneBitmapCount != ((header->patternCount + (uint64_t)63) / 64 + BITVECTOR_LANE_WORDS - 1) /
+                                        BITVECTOR_LANE_WORDS * BITVECTOR_LANE_WORDS) {
+        problem = "bad column length";
+    } else if(fileSize != sizeof(truthTableBinaryHeader_t) + ((uint64_t)header->inputCount + header->outputCount + careCount) *
+                          header->laneBitmapCount * sizeof(uint64_t)) {
+        problem = "file size does not match header";
+    } else if((header->flags & TRUTH_TABLE_BINARY_FLAG_COUNTER) &&
+              (header->inputCount > TRUTH_TABLE_KERNEL_MAX_INPUTS || header->patternCount != ((uint32_t)0x01) << header->inputCount)) {
+        problem = "counting order flag set on an incomplete table";
+    }
+
+    // Tables flagged as in counting order have their input columns compared with the counter
+    if(problem.empty() && (header->flags & TRUTH_TABLE_BINARY_FLAG_COUNTER)) {
+        uint32_t bitmapCount = (header->patternCount + (uint64_t)63) / 64;
+        uint64_t lastMask = header->patternCount % 64 ? ~((uint64_t)0) << (64 - header->patternCount % 64) : ~((uint64_t)0);
+        for(unsigned i = 0; i < header->inputCount && problem.empty(); i++) {
+            const uint64_t *column = &columns[(size_t)i * header->laneBitmapCount];
+            for(unsigned k = 0; k < bitmapCount; k++) {
+                uint64_t mask = k == bitmapCount - 1 ? lastMask : ~((uint64_t)0);
+                if(column[k] != (counterBitmap(i, k) & mask)) {
+                    problem = "counting order flag set on a table out of counting order";
+                    break;
+                }
+            }
+        }
+    }
+    if(problem.size()) {
+        throw(truthTableParseException("File '" + path + "', " + problem + "."));
+    }
+
+    // Columns stay in the mapping, the bit vectors only carry the table shape
+    *this = truthTable(header->inputCount, header->outputCount);
+    this->cares.resize(careCount);
+    this->mapping = mapping;
+    this->mappedColumns = columns;
+    this->mappedPatternCount = header->patternCount;
+    this->counterInputs = header->flags & TRUTH_TABLE_BINARY_FLAG_COUNTER;
+}
+
+
+
+//========[EVALUATION BLOCKS]====================================================================//
+
+
+// Unmap the file once the last table using it has gone
+truthTableMapping::~truthTableMapping() {
+    munmap(this->address, this->size);
+}
+
+
+// Bitmaps per evaluation block, a whole number of lanes that keeps a block in cache
+// and, with every thread holding one, within the resident budget
+uint32_t truthTable::getBlockBitmapCount(void) {
+    uint32_t columnCount = (this->counterInputs ? 0 : this->getInputCount()) + this->getOutputCount() + this->cares.size();
+    uint64_t columnBytes = (uint64_t)columnCount * sizeof(uint64_t);
+    uint64_t blockBytes = TRUTH_TABLE_BLOCK_BYTES;
+    if(this->residentBudget && this->residentBudget / this->residentThreadCount < blockBytes) {
+        blockBytes = this->residentBudget / this->residentThreadCount;
+    }
+    uint64_t count = blockBytes / columnBytes / BITVECTOR_LANE_WORDS * BITVECTOR_LANE_WORDS;
+    if(count < BITVECTOR_LANE_WORDS) count = BITVECTOR_LANE_WORDS;
+    if(count > this->getLaneBitmapCount()) count = this->getLaneBitmapCount();
+    return count;
+}
+
+
+// Get the columns of the block starting at firstBitmap, which must be a whole number of
+// lanes into the table. The following block of a mapped table is prefetched
+void truthTable::getBlock(uint32_t firstBitmap, truthTableBlock_t& block) {
+    uint32_t laneBitmapCount = this->getLaneBitmapCount();
+    block.firstBitmap = firstBitmap;
+    block.bitmapCount = min(this->getBlockBitmapCount(), this->getBitmapCount() - firstBitmap);
+    if(this->kernel) {
+        this->getGeneratedBlock(block);
+        return;
+    }
+
+    // Column pointers, inputs in counting order are left to the evaluator
+    block.counterInputs = this->counterInputs;
+    block.inputs.assign(this->getInputCount(), NULL);
+    block.outputs.resize(this->getOutputCount());
+    block.cares.resize(this->getOutputCount());
+    for(unsigned i = 0; i < block.inputs.size() && !this->counterInputs; i++) {
+        block.inputs[i] = this->getInputBitmaps(i) + firstBitmap;
+    }
+    for(unsigned i = 0; i < block.outputs.size(); i++) {
+        block.outputs[i] = this->getOutputBitmaps(i) + firstBitmap;
+    }
+
+    // Care columns, fully specified tables use the valid bit masks for every output
+    // Mapped tables have no mask column, so the block gets its own lane padded copy
+    const uint64_t *masks;
+    if(!this->mapping) {
+        masks = this->bitmapMasks.data() + firstBitmap;
+    } else {
+        uint32_t lanePadded = (block.bitmapCount + BITVECTOR_LANE_WORDS - 1) / BITVECTOR_LANE_WORDS * BITVECTOR_LANE_WORDS;
+        block.validMasks.resize(lanePadded);
+        for(unsigned k = 0; k < lanePadded; k++) {
+            block.validMasks[k] = this->getBitmapMask(firstBitmap + k);
+        }
+        masks = block.validMasks.data();
+    }
+    for(unsigned i = 0; i < block.cares.size(); i++) {
+        block.cares[i] = this->cares.empty() ? masks : this->getCareBitmaps(i) + firstBitmap;
+    }
+
+    // Ask for the next block of a mapped table while this one is evaluated
+    uint32_t next = firstBitmap + block.bitmapCount;
+    if(this->mapping && next < laneBitmapCount) {
+        uint32_t count = min(block.bitmapCount, laneBitmapCount - next);
+        this->advisePages(next, count, MADV_WILLNEED);
+    }
+}
+
+
+// Done with a block, a mapped table larger than the resident budget has its pages dropped
+// They are clean file pages, so a later block using them just faults them back in
+void truthTable::releaseBlock(truthTableBlock_t const& block) {
+    uint32_t columnCount = (this->counterInputs ? 0 : this->getInputCount()) + this->getOutputCount() + this->cares.size();
+    uint64_t tableBytes = (uint64_t)columnCount * this->getLaneBitmapCount() * sizeof(uint64_t);
+    if(this->mapping && this->residentBudget && tableBytes > this->residentBudget) {
+        this->advisePages(block.firstBitmap, block.bitmapCount, MADV_DONTNEED);
+    }
+}
+
+
+// Pass advice on a range of bitmaps of every mapped column to the kernel
+// Blocks are swept in order, so the range is taken down to page boundaries at both ends:
+// the page shared with the previous block is finished with and the one shared with the
+// next block is left for it. The final block takes the range up to the end of its pages
+// Inputs in counting order are never read, so are left alone
+void truthTable::advisePages(uint32_t firstBitmap, uint32_t bitmapCount, int advice) {
+    uintptr_t pageSize = sysconf(_SC_PAGESIZE);
+    bool final = firstBitmap + bitmapCount >= this->getBitmapCount();
+    uint32_t columnCount = this->getInputCount() + this->getOutputCount() + this->cares.size();
+    for(unsigned i = this->counterInputs ? this->getInputCount() : 0; i < columnCount; i++) {
+        const uint64_t *column = this->mappedColumns + (size_t)i * this->getLaneBitmapCount();
+        uintptr_t start = (uintptr_t)(column + firstBitmap) & ~(pageSize - 1);
+        uintptr_t end = (uintptr_t)(column + firstBitmap + bitmapCount);
+        end = final ? (end + pageSize - 1) & ~(pageSize - 1) : end & ~(pageSize - 1);
+        if(start < end) {
+            madvise((void *)start, end - start, advice);
+        }
+    }
+}
+
+
+
+//========[PROCEDURAL TARGETS]===================================================================//
+
+
+// Operand of width bits at position index within an input pattern, LSB first
+static inline uint32_t operand(uint32_t iPattern, uint32_t width, uint32_t index) {
+    return (iPattern >> (width * index)) & ((((uint32_t)0x01) << width) - 1);
+}
+
+
+// Built in kernel shapes
+static void twoOperandShape(uint32_t width, uint32_t& inputCount, uint32_t& outputCount) {
+    inputCount = width * 2;
+    outputCount = width;
+}
+
+static void carryShape(uint32_t width, uint32_t& inputCount, uint32_t& outputCount) {
+    inputCount = width * 2 + 1;
+    outputCount = width + 1;
+}
+
+static void productShape(uint32_t width, uint32_t& inputCount, uint32_t& outputCount) {
+    inputCount = width * 2;
+    outputCount = width * 2;
+}
+
+static void compareShape(uint32_t width, uint32_t& inputCount, uint32_t& outputCount) {
+    inputCount = width * 2;
+    outputCount = 3;
+}
+
+static void countShape(uint32_t width, uint32_t& inputCount, uint32_t& outputCount) {
+    inputCount = width;
+    outputCount = 32 - __builtin_clz(width);
+}
+
+
+// Built in kernel functions, same operand layout as the pattern generator has always used
+static uint32_t addKernel(uint32_t i, uint32_t w) {return operand(i, w, 0) + operand(i, w, 1);}
+static uint32_t addCarryKernel(uint32_t i, uint32_t w) {return operand(i, w, 0) + operand(i, w, 1) + operand(i, 1, 2 * w);}
+static uint32_t mulKernel(uint32_t i, uint32_t w) {return operand(i, w, 0) * operand(i, w, 1);}
+static uint32_t popcountKernel(uint32_t i, uint32_t) {return __builtin_popcount(i);}
+static uint32_t compareKernel(uint32_t i, uint32_t w) {
+    uint32_t a = operand(i, w, 0);
+    uint32_t b = operand(i, w, 1);
+    return (a < b) | ((a == b) << 1) | ((a > b) << 2);
+}
+
+
+// Registered kernels, searched newest first. Replaced kernels are kept so that blocks
+// generated by them can never be mistaken for blocks of a newer kernel at the same address
+static vector<shared_ptr<const truthTableKernel_t>>& kernelRegistry(void) {
+    static vector<shared_ptr<const truthTableKernel_t>> registry;
+    if(registry.empty()) {
+        truthTableKernel_t builtIns[] = {
+            {"add", "a + b, carry out dropped", twoOperandShape, addKernel},
+            {"addc", "a + b + carry in, with carry out", carryShape, addCarryKernel},
+            {"mul", "a * b", productShape, mulKernel},
+            {"cmp", "a < b, a == b, a > b", compareShape, compareKernel},
+            {"popcount", "number of set inputs", countShape, popcountKernel}};
+        for(unsigned i = 0; i < sizeof(builtIns) / sizeof(builtIns[0]); i++) {
+            registry.push_back(make_shared<const truthTableKernel_t>(builtIns[i]));
+        }
+    }
+    return registry;
+}
+
+
+// Register a kernel
+void truthTable::registerKernel(truthTableKernel_t const& kernel) {
+    kernelRegistry().push_back(make_shared<const truthTableKernel_t>(kernel));
+}
+
+
+// Names of the registered kernels
+vector<string> truthTable::getKernelNames(void) {
+    vector<string> names;
+    vector<shared_ptr<const truthTableKernel_t>>& registry = kernelRegistry();
+    for(unsigned i = 0; i < registry.size(); i++) {
+        if(find(names.begin(), names.end(), registry[i]->name) == names.end()) {
+            names.push_back(registry[i]->name);
+        }
+    }
+    return names;
+}
+
+
+// Procedural table from a kernel and operand width
+truthTable truthTable::generate(string kernelName, uint32_t width) {
+    vector<shared_ptr<const truthTableKernel_t>>& registry = kernelRegistry();
+    shared_ptr<const truthTableKernel_t> kernel;
+    for(unsigned i = registry.size(); i-- > 0 && !kernel;) {
+        if(registry[i]->name == kernelName) {
+            kernel = registry[i];
+        }
+    }
+    if(!kernel) {
+        throw(invalid_argument("Unrecognised truth table kernel '" + kernelName + "'."));
+    }
+
+    // Check the shape
+    uint32_t inputCount = 0;
+    uint32_t outputCount = 0;
+    if(width) {
+        kernel->shape(width, inputCount, outputCount);
+    }
+    if(!inputCount || inputCount > TRUTH_TABLE_KERNEL_MAX_INPUTS || !outputCount || outputCount > 32) {
+        stringstream ss;
+        ss << "Kernel '" << kernelName << "' can't be generated " << width << " bits wide.";
+        throw(invalid_argument(ss.str()));
+    }
+
+    // Columns are generated as needed, the bit vectors only carry the table shape
+    truthTable t(inputCount, outputCount);
+    t.kernel = kernel;
+    t.kernelWidth = width;
+    t.counterInputs = true;
+    return t;
+}
+
+
+// Procedural table from a "name:width" string
+truthTable truthTable::generate(string spec) {
+    size_t colon = spec.find(':');
+    uint32_t width = 0;
+    if(colon != string::npos) {
+        stringstream ss(spec.substr(colon + 1));
+        ss >> width;
+    }
+    if(!width) {
+        throw(invalid_argument("Generated target '" + spec + "' must be given as kernel:width."));
+    }
+    return truthTable::generate(spec.substr(0, colon), width);
+}
+
+
+// Generate output bitmaps of a procedural table, each column stride words after the last
+// Outputs of 64 patterns at a time go through the bit matrix transpose, inputs are
+// always in counting order so are never generated
+void truthTable::generateOutputBitmaps(uint32_t firstBitmap, uint32_t bitmapCount, uint64_t *columns, uint32_t stride) {
+    uint32_t outputCount = this->getOutputCount();
+    uint32_t patternCount = this->getPatternCount();
+    uint32_t outputMask = (uint32_t)((((uint64_t)0x01) << outputCount) - 1);
+    uint64_t block[64];
+    for(uint32_t k = 0; k < bitmapCount; k++) {
+
+        // Kernel outputs in the low half, so output c comes out in row 63 - c
+        uint32_t base = (firstBitmap + k) * 64;
+        for(unsigned j = 0; j < 64; j++) {
+            block[j] = base + j < patternCount ? this->kernel->function(base + j, this->kernelWidth) & outputMask : 0;
+        }
+        transposeBitMatrix(block);
+        for(unsigned i = 0; i < outputCount; i++) {
+            columns[i * stride + k] = block[63 - i];
+        }
+    }
+}
+
+
+// Fill a block of a procedural table, blocks kept from an earlier sweep are used as they are
+// Columns are the outputs then the valid masks, padding to a whole lane is left zero
+void truthTable::getGeneratedBlock(truthTableBlock_t& block) {
+    uint32_t outputCount = this->getOutputCount();
+    uint32_t blockBitmapCount = this->getBlockBitmapCount();
+    uint32_t lanePadded = (block.bitmapCount + BITVECTOR_LANE_WORDS - 1) / BITVECTOR_LANE_WORDS * BITVECTOR_LANE_WORDS;
+    size_t columnCount = outputCount + 1;
+
+    // Drop blocks kept for another table or block size
+    if(block.generatedKernel != this->kernel.get() || block.generatedWidth != this->kernelWidth ||
+       block.generatedBlockBitmapCount != blockBitmapCount) {
+        block.generated.clear();
+        block.generated.resize((this->getBitmapCount() + blockBitmapCount - 1) / blockBitmapCount);
+        block.generatedKernel = this->kernel.get();
+        block.generatedWidth = this->kernelWidth;
+        block.generatedBlockBitmapCount = blockBitmapCount;
+        block.generatedBytes = 0;
+    }
+
+    // Generate the block unless it is kept, keeping it if there is room
+    uint64_t limit = TRUTH_TABLE_GENERATED_BYTES;
+    if(this->residentBudget && this->residentBudget / this->residentThreadCount < limit) {
+        limit = this->residentBudget / this->residentThreadCount;
+    }
+    vector<uint64_t>& kept = block.generated[block.firstBitmap / blockBitmapCount];
+    vector<uint64_t> *columns = &kept;
+    if(kept.empty()) {
+        uint64_t bytes = columnCount * lanePadded * sizeof(uint64_t);
+        if(block.generatedBytes + bytes > limit) {
+            columns = &block.generatedScratch;
+        } else {
+            block.generatedBytes += bytes;
+        }
+        columns->assign(columnCount * lanePadded, 0);
+        this->generateOutputBitmaps(block.firstBitmap, block.bitmapCount, columns->data(), lanePadded);
+        for(unsigned k = 0; k < lanePadded; k++) {
+            (*columns)[outputCount * lanePadded + k] = this->getBitmapMask(block.firstBitmap + k);
+        }
+    }
+
+    // Column pointers into the generated bitmaps, every output is cared about
+    const uint64_t *base = columns->data();
+    block.counterInputs = true;
+    block.inputs.assign(this->getInputCount(), NULL);
+    block.outputs.resize(outputCount);
+    block.cares.assign(outputCount, base + (size_t)outputCount * lanePadded);
+    for(unsigned i = 0; i < outputCount; i++) {
+        block.outputs[i] = base + (size_t)i * lanePadded;
+    }
+}
@@ -14,17 +14,9 @@ using namespace std;
 #include "mpi.h"
 
 
-// Naive set bit counter, will optimise later (maybe)
+// Set bit counter, compiles to a popcount instruction where the target has one
 uint32_t countBits(uint64_t data) {
-    uint32_t bitCount = 0;
-
-    uint64_t bits = data;
-    while(bits) {
-        bitCount++;
-        bits &= (bits - 1);
-    }
-
-    return bitCount;
+    return __builtin_popcountll(data);
 }
 
 
@@ -47,6 +39,14 @@ int32_t rankCount(void) {
 
 
 
+// Drives the MPI progress engine so non-blocking operations move along
+void progressCommunication(void) {
+    int flag;
+    MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &flag, MPI_STATUS_IGNORE);
+}
+
+
+
 // Generates rank string for this rank
 string rankString(void) {
 